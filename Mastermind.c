@@ -1,8 +1,15 @@
+#define _GNU_SOURCE			// sched_setaffinity, CPU_SET
+
 // Button-controlled LED (in C), now truly standalone, controlling LED and button
 // Same as tinkerHaWo35.c but using different pins: pin 23 for LED, pin 24 for button
 
-// Compile: gcc  -o  t tut_button.c
+// Compile: gcc -O2 -o t Mastermind.c -lrt -lpthread
 // Run:     sudo ./t
+//          sudo ./t rj    (real-time scheduling, report delay jitter on exit)
+//          sudo ./t h     (hints from the advisor; ./t g builds its strategy cache offline)
+//          ./t b          (benchmark of the batch scoring kernels)
+//          ./t S          (game server on a UNIX socket; ./t L load-tests it)
+// Watch:   ./t s          (from another terminal, follows the running game)
 
 #include <stdio.h>
 #include <stdarg.h>
@@ -16,11 +23,37 @@
 #include <time.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
+#include <signal.h>
 #include <sys/time.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/file.h>
 #include <sys/wait.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+// NEON scorer: always there on 64-bit ARM; on 32-bit hard-float builds (plain armhf Raspbian,
+// no -mfpu=neon) only the kernel itself is compiled for NEON, and getauxval() decides at run time
+#if defined(__aarch64__)
+#define SCORE_NEON
+#define NEON_TARGET
+#elif defined(__arm__) && defined(__ARM_FP)
+#define SCORE_NEON
+#define NEON_TARGET __attribute__((target("fpu=neon")))
+#endif
+#ifdef SCORE_NEON
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
 
 // original code based in wiringPi library by Gordon Henderson
 // #include "wiringPi.h"
@@ -41,6 +74,70 @@
 #define DATA3_PIN 22
 // delay for loop iterations (mainly), in ms
 #define DELAY 200
+// color entry: button poll period, debounce (edges closer than this to the last one are
+// contact bounce), long press that accepts a peg at once, double-press window that undoes
+// the previous peg, and the on/off time of the per-peg echo; the idle timeout is
+// PEG_IDLE_FACTOR times the player's average gap between presses, clamped to
+// [PEG_IDLE_MIN_MS, PEG_IDLE_MAX_MS]
+#define PEG_POLL_MS 20
+#define PEG_DEBOUNCE_MS 40
+#define LONG_PRESS_MS 600
+#define DOUBLE_PRESS_MS 120
+#define PEG_ECHO_MS 150
+#define PEG_RHYTHM_MS 400
+#define PEG_IDLE_FACTOR 3
+#define PEG_IDLE_MIN_MS 600
+#define PEG_IDLE_MAX_MS 2500
+// software PWM feedback: period, shortest visible on-time and how long it is shown
+#define PWM_PERIOD_US 10000
+#define PWM_MIN_DUTY_US 300
+#define PWM_SHOW_MS 3000
+// with no exact and no colour matches both LEDs blink together at full brightness, on/off time
+#define PWM_NONE_BLINK_MS 250
+// longest secret the spectator feed records
+#define MAX_PEGS 8
+// shared-memory spectator feed: segment name and number of round events kept
+#define SPECTATOR_SHM "/mastermind-feed"
+#define SPECTATOR_RING 64
+// solver: colours are 1..MAX_COLORS, games last MAX_ROUNDS guesses, at most
+// SOLVER_MAX_CODES codes are enumerated and one hint scores at most ADVISOR_WORK pairs
+#define MAX_COLORS 15
+#define MAX_ROUNDS 3
+#define SOLVER_MAX_CODES (1u << 20)
+#define ADVISOR_WORK (1u << 24)
+// how long 'b' mode runs each scoring kernel
+#define BENCH_MICROS 200000
+// symmetry reduction: most position permutations tried per code before falling
+// back to swapping untouched colours only
+#define SYMMETRY_MAX_PERMS 720
+// strategy cache file per configuration (length, colors), and its initial size in nodes
+#define STRATEGY_FILE "strategy-%dx%d.bin"
+#define STRATEGY_INITIAL_NODES 64
+// multi-secret mode: most secrets at once (the history log keeps the solved count in
+// FEEDBACK()'s 4-bit exact field), rounds allowed on top of one per secret, and how long
+// the LCD shows each screen while it cycles through the secrets' feedback
+#define MULTI_MAX_SECRETS 15
+#define MULTI_EXTRA_ROUNDS 5
+#define MULTI_LCD_MS 1500
+// game history log: file, records kept before rotating, rounds stored per game and
+// number of (mode, length, colors) configurations with running totals
+#define HISTORY_FILE "mastermind-history.bin"
+#define HISTORY_CAPACITY 4096
+#define HISTORY_ROUNDS 24
+#define HISTORY_CONFIGS 32
+// game server: socket path, session slots, epoll batch and longest protocol line
+#define SERVER_SOCKET "/tmp/mastermind.sock"
+#define SERVER_MAX_SESSIONS 8192
+#define SERVER_EVENTS 256
+#define SERVER_LINE 128
+// load test: simulated clients, how long they play and the configuration they play
+#define LOAD_CLIENTS 1000
+#define LOAD_SECONDS 5
+#define LOAD_LENGTH 4
+#define LOAD_COLORS 6
+// real-time mode: SCHED_FIFO priority and the CPU the game is pinned to
+#define RT_PRIORITY 50
+#define RT_CPU 3
 // =======================================================
 
 #ifndef	TRUE
@@ -139,6 +236,9 @@ static volatile uint32_t *gpio ;
 // protos
 int failure (int fatal, const char *message, ...);
 void waitForEnter (void);
+void game (int *mainSecret, int sequenceLength, int maxColors, struct lcdDataStruct *lcd, int roundNum);
+void pwmStop (void);
+void multiLcdStep (void);
 
 /* ------------------------------------------------------- */
 /* low-level interface to the hardware */
@@ -255,10 +355,152 @@ void waitForEnter (void)
     (void)fgetc (stdin) ;
 }
 
+/* ------------------------------------------------------- */
+/* timing: monotonic clock, real-time mode and the jitter probe behind delay() */
+
+// per-sleep lateness histogram, bucket b holds wake-ups 2^(b-1) <= late < 2^b microseconds
+#define JITTER_BUCKETS 20
+
+struct jitterProbe
+{
+    const char *name ;
+    uint64_t samples, sumUs, maxUs ;
+    uint32_t hist [JITTER_BUCKETS] ;
+} ;
+
+static int jitterOn ;
+static volatile sig_atomic_t jitterStop ;		// set by Ctrl-C, acted on by the next sleep
+static struct jitterProbe jitterDelay   = { "delay()" } ;
+static struct jitterProbe jitterDelayUs = { "delayMicroseconds()" } ;
+
+uint64_t monotonicMicros(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+//Adds one sample to the histogram
+void jitterRecord(struct jitterProbe *probe, uint64_t us) {
+    int bucket = 0;
+    while (bucket < JITTER_BUCKETS-1 && (us >> bucket) != 0)
+        bucket++;
+
+    probe->samples++;
+    probe->sumUs += us;
+    if (us > probe->maxUs)
+        probe->maxUs = us;
+    probe->hist[bucket]++;
+}
+
+//Sleeps until an absolute wake time and records how late the wake-up actually was
+void jitterSleep(struct jitterProbe *probe, uint64_t howLongUs) {
+    struct timespec target, woke;
+    clock_gettime(CLOCK_MONOTONIC, &target);
+    target.tv_sec  += howLongUs / 1000000;
+    target.tv_nsec += (howLongUs % 1000000) * 1000;
+    if (target.tv_nsec >= 1000000000) {
+        target.tv_sec++;
+        target.tv_nsec -= 1000000000;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL) == EINTR && !jitterStop)
+        ;
+    if (jitterStop)
+        exit(EXIT_SUCCESS);				// runs jitterReport through atexit, outside the handler
+    clock_gettime(CLOCK_MONOTONIC, &woke);
+
+    int64_t lateNs = (int64_t)(woke.tv_sec - target.tv_sec) * 1000000000 + (woke.tv_nsec - target.tv_nsec);
+    jitterRecord(probe, lateNs > 0 ? (uint64_t)lateNs / 1000 : 0);
+}
+
+//Upper bound (in us) of the bucket holding the given fraction of samples, never above the maximum seen
+static uint64_t jitterPercentile(const struct jitterProbe *probe, double fraction) {
+    uint64_t want = (uint64_t)(probe->samples * fraction), seen = 0;
+    for (int b = 0; b < JITTER_BUCKETS; b++) {
+        seen += probe->hist[b];
+        if (seen > want)
+            return ((uint64_t)1 << b) < probe->maxUs ? (uint64_t)1 << b : probe->maxUs;
+    }
+    return probe->maxUs;
+}
+
+static void jitterPrint(const struct jitterProbe *probe) {
+    if (probe->samples == 0)
+        return;
+    fprintf(stderr, "%s: %llu sleeps, late by mean %llu us, p50 <= %llu us, p99 <= %llu us, max %llu us\n",
+        probe->name, (unsigned long long)probe->samples,
+        (unsigned long long)(probe->sumUs / probe->samples),
+        (unsigned long long)jitterPercentile(probe, 0.50),
+        (unsigned long long)jitterPercentile(probe, 0.99),
+        (unsigned long long)probe->maxUs);
+    for (int b = 0; b < JITTER_BUCKETS; b++) {
+        if (probe->hist[b] != 0)
+            fprintf(stderr, "    < %7llu us  %u\n", (unsigned long long)1 << b, probe->hist[b]);
+    }
+}
+
+void jitterReport(void) {
+    fprintf(stderr, "\n----- timing jitter (scheduled vs actual wake) -----\n");
+    jitterPrint(&jitterDelay);
+    jitterPrint(&jitterDelayUs);
+}
+
+//Only flags the stop: stdio is not async-signal-safe, so the report is printed by the next sleep.
+//A second Ctrl-C (e.g. while blocked reading a menu choice) quits at once without a report.
+static void jitterInterrupted(int sig) {
+    if (jitterStop)
+        _exit(EXIT_FAILURE);
+    jitterStop = 1;
+}
+
+//Starts recording every sleep in delay()/delayMicroseconds(), reported when the program exits
+void jitterStart(void) {
+    struct sigaction sa;
+
+    if (jitterOn)					//main() runs again after a rejected menu choice
+        return;
+    jitterOn = TRUE;
+    atexit(jitterReport);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = jitterInterrupted;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;				//a pending scanf keeps reading; sleeps still return EINTR
+    sigaction(SIGINT, &sa, NULL);
+}
+
+//Real-time mode: no page faults, FIFO scheduling and a dedicated CPU for the bit-banging
+void realtimeSetup(void) {
+    static int started;
+    struct sched_param param;
+    cpu_set_t cpus;
+
+    if (started)					//main() runs again after a rejected menu choice
+        return;
+    started = TRUE;
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+        fprintf(stderr, "realtime: mlockall failed: %s\n", strerror(errno));
+
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = RT_PRIORITY;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) < 0)
+        fprintf(stderr, "realtime: SCHED_FIFO failed: %s\n", strerror(errno));
+
+    CPU_ZERO(&cpus);
+    CPU_SET(RT_CPU, &cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) < 0)
+        fprintf(stderr, "realtime: pinning to CPU %d failed: %s\n", RT_CPU, strerror(errno));
+}
+
 void delay (unsigned int howLong)
 {
     struct timespec sleeper, dummy ;
 
+    if (jitterOn)
+    {
+        jitterSleep (&jitterDelay, (uint64_t)howLong * 1000) ;
+        return ;
+    }
+
     sleeper.tv_sec  = (time_t)(howLong / 1000) ;
     sleeper.tv_nsec = (long)(howLong % 1000) * 1000000 ;
 
@@ -273,6 +515,8 @@ void delayMicroseconds (unsigned int howLong)
 
     /**/ if (howLong ==   0)
         return ;
+    else if (jitterOn)
+        jitterSleep (&jitterDelayUs, howLong) ;
 #if 0
     else if (howLong  < 100)
         delayMicrosecondsHard (howLong) ;
@@ -368,6 +612,7 @@ void lcdClear (struct lcdDataStruct *lcd)
 #ifdef DEBUG
     fprintf(stderr, "lcdClear: lcdPutCommand(%d,%d) and lcdPutCommand(%d,%d)\n", lcd, LCD_CLEAR, lcd, LCD_HOME);
 #endif
+    pwmStop () ;		// LED feedback belongs to what the LCD showed until now
     lcdPutCommand (lcd, LCD_CLEAR) ;
     lcdPutCommand (lcd, LCD_HOME) ;
     lcd->cx = lcd->cy = 0 ;
@@ -442,6 +687,7 @@ void lcdPuts (struct lcdDataStruct *lcd, const char *string)
 }
 
 void blinkRed(int n) {						//function to blink the red LED
+    pwmStop();
     int i;
     for(i = 0; i < n; i++) {
         int theValue = ((i  % 2) == 0) ? LOW : HIGH;		//if the value%2 is 0 then it sets the value to LOW,else it's HIGH
@@ -452,6 +698,7 @@ void blinkRed(int n) {						//function to blink the red LED
 }
 
 void blinkYellow(int n) {					//function to blink the yellow LED
+    pwmStop();
     int i;
     for(i = 0; i < n; i++) {
         int theValue = ((i  % 2) == 0) ? LOW : HIGH;		//if the value%2 is 0 then it sets the value to LOW,else it's HIGH
@@ -462,6 +709,7 @@ void blinkYellow(int n) {					//function to blink the yellow LED
 }
 
 void blinkRedAssembly(int n) {					//blink red LED in assembly
+    pwmStop();
     int theValue;
     for(int i = 0; i < n; i++) {
         theValue = ((i% 2) == 0) ? HIGH : LOW;
@@ -490,6 +738,7 @@ void blinkRedAssembly(int n) {					//blink red LED in assembly
 }
 //This function blinks the yellow LED in asembly
 void blinkYellowAssembly(int n) {			//blink yellow LED in assembly
+    pwmStop();
     
     //The loop that controls the value of the off variable, which holds the register to be used
     int theValue;
@@ -520,6 +769,241 @@ void blinkYellowAssembly(int n) {			//blink yellow LED in assembly
     }
 }
 
+/* ------------------------------------------------------- */
+/* software PWM: both LEDs lit at once, brightness showing exact (yellow) and color (red) */
+/* A timer thread switches both LEDs on at the start of every PWM_PERIOD_US period and */
+/* each one off again once its duty is used up, so it wakes at most three times per    */
+/* period and sleeps the rest, whatever the brightness. It runs in the background while */
+/* the game goes on; anything else that drives the LEDs calls pwmStop() first.          */
+
+struct pwmState
+{
+    unsigned dutyYellow, dutyRed ;			// on-time per period, in us
+    unsigned ms ;					// how long to show them
+    int none ;						// 0/0 feedback: blink both instead of staying dark
+    int stop ;						// set by pwmStop() to end the display early
+    struct jitterProbe period ;				// how late each period started
+    uint64_t cpuUs, wallUs ;
+} ;
+
+static void pwmWrite(int pin, int value) {
+    int off = (value == HIGH) ? 7 : 10;				//GPSET0 or GPCLR0, as in blinkRed()
+    *(gpio + off) = 1 << (pin & 31);
+}
+
+static void pwmSleepUntil(const struct timespec *when) {
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, when, NULL) == EINTR)
+        ;
+}
+
+static void pwmAdd(struct timespec *t, const struct timespec *from, unsigned us) {
+    t->tv_sec = from->tv_sec;
+    t->tv_nsec = from->tv_nsec + (long)us * 1000;
+    while (t->tv_nsec >= 1000000000) {
+        t->tv_sec++;
+        t->tv_nsec -= 1000000000;
+    }
+}
+
+static struct pwmState pwm ;
+static pthread_t pwmThreadId ;
+static int pwmRunning ;
+
+static void *pwmThread(void *arg) {
+    struct pwmState *pwm = arg;
+    struct timespec start, cpu0, cpu1, now, edge;
+    unsigned first = pwm->dutyYellow < pwm->dutyRed ? pwm->dutyYellow : pwm->dutyRed;
+    unsigned last  = pwm->dutyYellow < pwm->dutyRed ? pwm->dutyRed : pwm->dutyYellow;
+    int firstPin = pwm->dutyYellow < pwm->dutyRed ? LEDYELLOW : LEDRED;
+    int lastPin  = pwm->dutyYellow < pwm->dutyRed ? LEDRED : LEDYELLOW;
+    uint64_t periods = (uint64_t)pwm->ms * 1000 / PWM_PERIOD_US;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu0);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct timespec period = start;
+    for (uint64_t p = 0; p < periods && !__atomic_load_n(&pwm->stop, __ATOMIC_ACQUIRE); p++) {
+        if (pwm->none)					//both fully on or both off, PWM_NONE_BLINK_MS each
+            first = last = (p * PWM_PERIOD_US / 1000 / PWM_NONE_BLINK_MS) % 2 == 0 ? PWM_PERIOD_US : 0;
+        pwmSleepUntil(&period);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t lateNs = (int64_t)(now.tv_sec - period.tv_sec) * 1000000000 + (now.tv_nsec - period.tv_nsec);
+        jitterRecord(&pwm->period, lateNs > 0 ? (uint64_t)lateNs / 1000 : 0);
+
+        pwmWrite(firstPin, first > 0 ? HIGH : LOW);
+        pwmWrite(lastPin, last > 0 ? HIGH : LOW);
+        if (first > 0 && first < PWM_PERIOD_US) {
+            pwmAdd(&edge, &period, first);
+            pwmSleepUntil(&edge);
+            pwmWrite(firstPin, LOW);
+        }
+        if (last > 0 && last < PWM_PERIOD_US) {
+            pwmAdd(&edge, &period, last);
+            pwmSleepUntil(&edge);
+            pwmWrite(lastPin, LOW);
+        }
+        pwmAdd(&period, &period, PWM_PERIOD_US);
+    }
+    pwmWrite(LEDYELLOW, LOW);
+    pwmWrite(LEDRED, LOW);
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu1);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pwm->cpuUs = (uint64_t)(cpu1.tv_sec - cpu0.tv_sec) * 1000000 + (cpu1.tv_nsec - cpu0.tv_nsec) / 1000;
+    pwm->wallUs = (uint64_t)(now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
+    return NULL;
+}
+
+//On-time for showing level out of max; squared so equal steps look roughly equally brighter
+static unsigned pwmDuty(int level, int max) {
+    if (level <= 0 || max <= 0)
+        return 0;
+    if (level >= max)
+        return PWM_PERIOD_US;
+    unsigned duty = (unsigned)((uint64_t)PWM_PERIOD_US * level * level / (max * max));
+    return duty < PWM_MIN_DUTY_US ? PWM_MIN_DUTY_US : duty;
+}
+
+//Waits for the display to run out, or ends it early when stop is set, and leaves both LEDs off
+static void pwmJoin(int stop) {
+    if (!pwmRunning)
+        return;
+    if (stop)
+        __atomic_store_n(&pwm.stop, TRUE, __ATOMIC_RELEASE);
+    pthread_join(pwmThreadId, NULL);
+    pwmRunning = FALSE;
+
+    if (jitterOn && pwm.wallUs != 0) {
+        jitterPrint(&pwm.period);
+        fprintf(stderr, "pwm: %llu periods of %d us, %.2f%% of a CPU\n", (unsigned long long)pwm.period.samples,
+                PWM_PERIOD_US, 100.0 * pwm.cpuUs / pwm.wallUs);
+    }
+}
+
+//Ends a feedback display that is still running; called before anything else drives the LEDs
+void pwmStop(void) {
+    pwmJoin(TRUE);
+}
+
+//Lets a running feedback display finish; the game calls it before it ends
+void pwmFinish(void) {
+    pwmJoin(FALSE);
+}
+
+//Starts the thread. In real-time mode it would inherit SCHED_FIFO at RT_PRIORITY on RT_CPU and
+//never get the CPU while the main thread computes a hint, so it runs one priority level above it
+static int pwmCreate(void) {
+    pthread_attr_t attr;
+    struct sched_param param;
+
+    if (sched_getscheduler(0) != SCHED_FIFO)
+        return pthread_create(&pwmThreadId, NULL, pwmThread, &pwm);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = RT_PRIORITY + 1;
+    pthread_attr_setschedparam(&attr, &param);
+    int err = pthread_create(&pwmThreadId, &attr, pwmThread, &pwm);
+    pthread_attr_destroy(&attr);
+    return err;
+}
+
+//Shows exact matches as yellow brightness and colour matches as red brightness for ms, in the
+//background: the call returns at once. No matches at all blinks both LEDs instead.
+void pwmShowFeedback(int exact, int color, int length, unsigned ms) {
+    pwmStop();
+    memset(&pwm, 0, sizeof(pwm));
+    pwm.period.name = "pwm period start";
+    pwm.dutyYellow = pwmDuty(exact, length);
+    pwm.dutyRed = pwmDuty(color, length);
+    pwm.none = (exact == 0 && color == 0);
+    pwm.ms = ms;
+
+    if (pwmCreate() != 0) {					//no thread: fall back to the blink sequence
+        blinkYellowAssembly(exact*2);
+        blinkRedAssembly(2);
+        blinkYellowAssembly(color*2);
+        return;
+    }
+    pwmRunning = TRUE;
+}
+
+//Echoes an accepted peg: a short red flash, then one short yellow flash per press
+void pegEcho(int presses) {
+    pwmStop();
+    pwmWrite(LEDRED, HIGH);
+    delay(PEG_ECHO_MS);
+    pwmWrite(LEDRED, LOW);
+    delay(PEG_ECHO_MS);
+    for (int i = 0; i < presses; i++) {
+        pwmWrite(LEDYELLOW, HIGH);
+        delay(PEG_ECHO_MS);
+        pwmWrite(LEDYELLOW, LOW);
+        delay(PEG_ECHO_MS);
+    }
+}
+
+//Reads one peg from the button and returns the number of presses. The peg is committed by a long
+//press, by reaching numColors, or once the button has been idle for a few of the player's own
+//press gaps. Edges within PEG_DEBOUNCE_MS of the previous one are ignored, so a bouncing contact
+//counts once. A double-press faster than DOUBLE_PRESS_MS at the start of a peg returns -1 instead
+//(undo the previous peg); a deliberate double tap for colour 2 is slower than that.
+int readPeg(int numColors, int canUndo) {
+    static uint64_t rhythm = PEG_RHYTHM_MS;		//running average gap between presses, learned across pegs
+    int counter = 0;
+    int currentvalue = HIGH;
+    uint64_t pressedAt = 0, edgeAt = 0;
+
+    for (;;) {
+        uint64_t now = monotonicMicros() / 1000;
+        uint64_t idle = rhythm * PEG_IDLE_FACTOR;
+        if (idle < PEG_IDLE_MIN_MS) idle = PEG_IDLE_MIN_MS;
+        if (idle > PEG_IDLE_MAX_MS) idle = PEG_IDLE_MAX_MS;
+
+        if((BUTTON & 0xFFFFFFC0) == 0) {
+            int res = assemblyInput(BUTTON);
+            int settled = now - edgeAt >= PEG_DEBOUNCE_MS;	//edges right after the last one are contact bounce
+            if ((res != 0) && (currentvalue == HIGH) && settled) {	//only a change from released to pressed counts
+                currentvalue = LOW;
+                edgeAt = now;
+                if (counter > 0) {
+                    uint64_t gap = now - pressedAt;
+                    if (canUndo && counter == 1 && gap < DOUBLE_PRESS_MS) {
+                        counter = -1;
+                        break;
+                    }
+                    rhythm = (3*rhythm + gap) / 4;
+                }
+                counter++;
+                pressedAt = now;
+                printf("    Button Pressed\n");
+            }
+            else if ((res == 0) && (currentvalue == LOW) && settled) {
+                currentvalue = HIGH;
+                edgeAt = now;
+            }
+        }
+        else {
+            fprintf(stderr, "only supporting on-board pins\n");
+        }
+
+        if (counter == numColors)
+            break;
+        if (counter > 0 && currentvalue == LOW && now - pressedAt >= LONG_PRESS_MS)
+            break;						//long press: accept the peg straight away
+        if (counter > 0 && currentvalue == HIGH && now - pressedAt >= idle)
+            break;
+        multiLcdStep();					//multi-secret mode: next feedback screen, if it is due
+        delay(PEG_POLL_MS);
+    }
+
+    //wait for the release so a held button is not read as the first press of the next peg
+    while (assemblyInput(BUTTON) != 0)
+        delay(PEG_POLL_MS);
+    return counter;
+}
+
 //This function allows the user to enter the secret for someone else to guess
 int *colorInput(int loopNum, int numColors) {
 
@@ -527,52 +1011,24 @@ int *colorInput(int loopNum, int numColors) {
     //Mallocs the array that will hold the secret
     int *secret = (int*)malloc(sizeof(int) * loopNum);
     
-    int theValue;
-    int counter = 0;
-    int timer = 0;
+    int counter;
     int colorNum;
-    int currentvalue = HIGH;
     
     //This loops runs as many times as the chosen length of the secret
     fprintf(stderr, "-----------------------------\nStart entering the secret\n-----------------------------\n\n");
     for(colorNum = 0; colorNum <loopNum; colorNum++) {
         fprintf(stderr, "  -----------------\n\n  Enter color number %d\n\n", colorNum+1);
-        while(counter < numColors) {
-            if((BUTTON & 0xFFFFFFC0) == 0) {
-                theValue = LOW;
-
-                //Check the button value, if it's not 0, then it's being pressed, and also check if it was being pressed in the pervious
-                //loop, this is to avoid one press registering as multiple presses
-                if (((*(gpio + 13) & (1 << (BUTTON & 31))) != 0) && (currentvalue == HIGH)) {
-                    theValue = LOW;
-                    currentvalue = LOW;
-                    counter++;
-                    timer = 0;
-                    printf("    Button Pressed\n");
-                }
-                else if (((*(gpio + 13) & (1 << (BUTTON & 31))) == 0) && (currentvalue == LOW)) {
-                    theValue = HIGH;
-                    currentvalue = HIGH;
-                }
-            }
-            else {
-                fprintf(stderr, "only supporting on-board pins\n");
-            }
-            delay(50);
-            timer++;
-            
-            //Stop recording the current color if the last button press was 50 cycles ago (50ms each)
-            if(timer == 50) {
-                break;
-            }
+        counter = readPeg(numColors, colorNum > 0);
+        if (counter < 0) {				//double-press: go back and re-enter the previous color
+            printf("\n  Undo color %d\n\n", colorNum);
+            blinkRed(2);
+            colorNum -= 2;
+            continue;
         }
         secret[colorNum] = counter;
         printf("\n  End of guess %d\n", colorNum+1);
         printf("  You pressed the button %d time(s)\n\n", counter);
-        blinkRed(2);
-        blinkYellow((counter*2));
-        counter = 0;
-        timer = 0;
+        pegEcho(counter);
     }
     printf("-----------------------------\nEnd of entering the secret\n-----------------------------\n\n");
     
@@ -688,226 +1144,2138 @@ struct lcdDataStruct *setlcd () {
 
 
 
-/* Main ----------------------------------------------------------------------------- */
-
-int main (int argc, char **argv)
-{
-    if(argc != 0 ) {
-        if(argv[argc-1][0] == 'd') {				// To enter debug mode, where the secret will be displayed to the user at the start
-            printf("Welcome to debug mode (YOU CHEATER)\n\n", argc);
-        }
-        else if(argv[argc-1][0] == '.') {			// Normal game mode
-            printf("Welcome to Mastermind :)\n\n");
-        }
-        else {
-            printf("This is not a supported mode(try 'd' or nothing)\n\n");
-        }
-
-    }
+/* ***************************************************************************** */
+/* Spectator feed: live game state published in POSIX shared memory             */
+/* The game is the only writer. The snapshot is guarded by a seqlock and round   */
+/* events go into a ring where every slot carries its own sequence number, so    */
+/* the writer never waits for (or even knows about) the readers attached.        */
 
-    int   fd ;
+#define SPECTATOR_MAGIC 0x4D4D5346			// "MMSF"
 
-    //printf ("Raspberry Pi button controlled LED (button in %d, led out %d)\n", BUTTON, LEDYELLOW) ;
+enum gamePhase { PHASE_IDLE, PHASE_INPUT, PHASE_SCORED, PHASE_WON, PHASE_LOST } ;
 
-    if (geteuid () != 0)
-        fprintf (stderr, "setup: Must be root. (Did you forget sudo?)\n") ;
+struct spectatorSnapshot
+{
+    uint32_t seq ;					// odd while the writer is updating
+    int32_t round, phase ;
+    int32_t length, colors ;
+    int32_t guess [MAX_PEGS] ;
+    int32_t exact, color ;
+} ;
 
-    // -----------------------------------------------------------------------------
-    // constants for RPi2
-    gpiobase = 0x3F200000 ;
+struct spectatorEvent
+{
+    uint32_t seq ;					// 2n+2 once event n is complete, odd while written
+    int32_t round ;
+    int32_t guess [MAX_PEGS] ;
+    int32_t exact, color ;
+} ;
 
-    // -----------------------------------------------------------------------------
-    // memory mapping
-    // Open the master /dev/memory device
+struct spectatorFeed
+{
+    uint32_t magic, ringSize ;
+    uint32_t generation ;				// bumped by every game that reuses the segment
+    struct spectatorSnapshot state ;
+    uint64_t head ;					// number of events published so far
+    struct spectatorEvent ring [SPECTATOR_RING] ;
+} ;
 
-    if ((fd = open ("/dev/mem", O_RDWR | O_SYNC | O_CLOEXEC) ) < 0)		//enables file read and write
-        return failure (FALSE, "setup: Unable to open /dev/mem: %s\n", strerror (errno)) ;
+static struct spectatorFeed *feed ;
 
-    // GPIO:
-    gpio = (uint32_t *)mmap(0, BLOCK_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, gpiobase) ;
-    if ((int32_t)gpio == -1)
-        return failure (FALSE, "setup: mmap (GPIO) failed: %s\n", strerror (errno)) ;
+//Creates (or reuses) the shared segment; the game runs fine without it
+void feedOpen(int length, int colors) {
+    int fd = shm_open(SPECTATOR_SHM, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        failure(FALSE, "feed: shm_open failed: %s\n", strerror(errno));
+        return;
+    }
+    if (ftruncate(fd, sizeof(struct spectatorFeed)) < 0) {
+        close(fd);
+        return;
+    }
+    void *p = mmap(0, sizeof(struct spectatorFeed), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return;
+
+    feed = (struct spectatorFeed *)p;
+    uint32_t generation = feed->magic == SPECTATOR_MAGIC ? feed->generation + 1 : 0;
+    memset(feed, 0, sizeof(struct spectatorFeed));
+    feed->ringSize = SPECTATOR_RING;
+    __atomic_store_n(&feed->generation, generation, __ATOMIC_RELEASE);
+    feed->state.length = length;
+    feed->state.colors = colors;
+    __atomic_store_n(&feed->magic, SPECTATOR_MAGIC, __ATOMIC_RELEASE);
+}
 
-    // -----------------------------------------------------------------------------
-    // setting the mode
+//Copies a guess into the feed, truncating secrets longer than MAX_PEGS
+static void feedCopyGuess(int32_t *dst, const int *guess, int length) {
+    for (int i = 0; i < MAX_PEGS; i++) {
+        dst[i] = (guess != NULL && i < length) ? guess[i] : 0;
+    }
+}
 
-    // controlling YELLOW LED pin 13
-    pinMode(LEDYELLOW, OUTPUT);			//calls the inline function for setting the pin and mode, in this case it's output
+//Publishes the session snapshot; guess may be NULL while nothing has been entered yet
+void feedState(int round, int phase, const int *guess, int length, int exact, int color) {
+    if (feed == NULL)
+        return;
+    struct spectatorSnapshot *s = &feed->state;
+    uint32_t seq = s->seq;
+
+    __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->round = round;
+    s->phase = phase;
+    feedCopyGuess(s->guess, guess, length);
+    s->exact = exact;
+    s->color = color;
+    __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+}
 
-    // controller RED LED pin 5
-    pinMode(LEDRED, OUTPUT);			//calls the inline function for setting the pin and mode, in this case it's output
+//Appends a scored round to the ring, overwriting the oldest event once it is full
+void feedEvent(int round, const int *guess, int length, int exact, int color) {
+    if (feed == NULL)
+        return;
+    uint64_t n = feed->head;
+    struct spectatorEvent *e = &feed->ring[n % SPECTATOR_RING];
+
+    __atomic_store_n(&e->seq, (uint32_t)(2*n + 1), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    e->round = round;
+    feedCopyGuess(e->guess, guess, length);
+    e->exact = exact;
+    e->color = color;
+    __atomic_store_n(&e->seq, (uint32_t)(2*n + 2), __ATOMIC_RELEASE);
+    __atomic_store_n(&feed->head, n + 1, __ATOMIC_RELEASE);
+}
 
-    // controlling button pin 
-    pinMode(BUTTON, INPUT);			//calls the inline function for setting the pin and mode, here it's input because we're using a button
+//Reader side: takes a consistent copy of the snapshot straight out of the mapping
+void feedReadState(const struct spectatorFeed *f, struct spectatorSnapshot *out) {
+    uint32_t before, after;
+    do {
+        before = __atomic_load_n(&f->state.seq, __ATOMIC_ACQUIRE);
+        memcpy(out, (const void *)&f->state, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&f->state.seq, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+}
 
-    // -----------------------------------------------------------------------------
-    struct lcdDataStruct *lcd = setlcd();
+//Reader side: fetches event n; returns FALSE if the writer has already lapped it
+int feedReadEvent(const struct spectatorFeed *f, uint64_t n, struct spectatorEvent *out) {
+    const struct spectatorEvent *e = &f->ring[n % SPECTATOR_RING];
+    uint32_t want = (uint32_t)(2*n + 2);
 
-    int mode;
-    int length;
-    int colors;
-    printf("1-Single Player(Randomly Generated)\n2-Two Player\nplease select an option: ");		//providing the user with an option, which will be entered through the terminal
-    scanf("%d",&mode);
+    if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != want)
+        return FALSE;
+    memcpy(out, (const void *)e, sizeof(*out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&e->seq, __ATOMIC_RELAXED) == want;
+}
 
-    printf("Enter the length of the secret: ");
-    scanf("%d",&length);
+//Spectator mode: attaches read-only to a running game and prints what happens
+int spectate(void) {
+    static const char *phases[] = { "idle", "entering guess", "scored", "won", "lost" };
+    int fd = shm_open(SPECTATOR_SHM, O_RDONLY, 0);
+    if (fd < 0)
+        return failure(TRUE, "spectate: no game running (%s)\n", strerror(errno));
+
+    const struct spectatorFeed *f = mmap(0, sizeof(struct spectatorFeed), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (f == MAP_FAILED || __atomic_load_n(&f->magic, __ATOMIC_ACQUIRE) != SPECTATOR_MAGIC)
+        return failure(TRUE, "spectate: feed not initialised\n");
+
+    struct spectatorSnapshot state;
+    struct spectatorEvent event;
+    uint32_t generation = __atomic_load_n(&f->generation, __ATOMIC_ACQUIRE);
+    uint64_t next = __atomic_load_n(&f->head, __ATOMIC_ACQUIRE);
+    uint32_t lastSeq = 0;
+
+    for (;;) {
+        if (__atomic_load_n(&f->generation, __ATOMIC_ACQUIRE) != generation) {
+            generation = __atomic_load_n(&f->generation, __ATOMIC_ACQUIRE);
+            printf("--- new game ---\n");		//the ring was reset: follow it from its first event
+            next = 0;
+            lastSeq = 0;
+        }
+        uint64_t head = __atomic_load_n(&f->head, __ATOMIC_ACQUIRE);
+        if (head < next)				//reset under us before the generation was bumped
+            next = head;
+        if (head - next > SPECTATOR_RING) {
+            printf("  (missed %llu events)\n", (unsigned long long)(head - next - SPECTATOR_RING));
+            next = head - SPECTATOR_RING;
+        }
+        for (; next < head; next++) {
+            if (!feedReadEvent(f, next, &event))
+                continue;
+            printf("Round %d:", event.round + 1);
+            for (int i = 0; i < MAX_PEGS && event.guess[i] != 0; i++)
+                printf(" %d", event.guess[i]);
+            printf("  ->  exact %d, color %d\n", event.exact, event.color);
+        }
 
-    printf("Enter number of colours available: ");
-    scanf("%d",&colors);
-    printf("\n\n");
+        feedReadState(f, &state);
+        if (state.seq != lastSeq) {
+            lastSeq = state.seq;
+            if (state.phase >= PHASE_IDLE && state.phase <= PHASE_LOST)
+                printf("[round %d/%dx%d] %s\n", state.round + 1, state.length, state.colors, phases[state.phase]);
+        }
+        fflush(stdout);
+        delay(100);
+    }
+    return 0;
+}
 
-    if (mode==1) {
 
-        int secret[length];
-        srand(time(NULL));				//randomly generates the secret for the user, that will be used in the game
-        for (int i=0; i<length; i++) {
-            secret[i]=(rand() % colors)+1 ;		//stores each random value in an array, the random value starts from 1 and goes up tp the number of colours available 
-        }
-        if(argv[argc-1][0] == 'd') {			//debug mode
-            printf("The secret is\n");
-            for(int i=0; i<length; i++) {
-                fprintf(stderr,"%d   ", secret[i]);		//displays secret for the user
-            }
+/* ***************************************************************************** */
+/* Game scoring: the loops game() used to inline, plus fully unrolled versions   */
+/* for the configurations we play most. gameScorer is picked in main() once the  */
+/* length and number of colours are known.                                       */
+
+typedef void (*gameScoreFn) (const int *guess, const int *secret, int length, int colors, int *exact, int *color) ;
+
+//Any configuration: exact hits first, then each remaining guess peg takes one matching secret peg
+void scoreGeneric(const int *guess, const int *secret, int length, int colors, int *exact, int *color) {
+    int g[length], s[length];
+    memcpy(g, guess, sizeof(g));
+    memcpy(s, secret, sizeof(s));
+    *exact = 0;
+    *color = 0;
+    for(int colorI = 0; colorI<length; colorI++) {		//loops in both arrays and compares values at the same index
+        if(g[colorI] == s[colorI]) {
+            (*exact)++;
+            s[colorI] = colors+1;				//changes the secret value to a number that will not be used in the secret so that the comparison doesn't get affected
+            g[colorI] = colors+2;
         }
-        delay(3000);
-        fprintf(stderr, "\n\n-----------------\nStarting Round 1\n-----------------\n\n");
-        game(secret, length, colors, lcd, 0);			//takes in the arguments for the game function
     }
-    else if (mode==2) {
-        delay(3000);
-        int *secret = colorInput(length, colors);		//used a pointer to point to the values passed into the colorInput function
-
-        if(argv[argc-1][0] == 'd') {
-            printf("The secret is\n");
-            for(int i=0; i<length; i++) {
-                fprintf(stderr,"%d   ", secret[i]);
+    for(int colorI = 0; colorI < length; colorI++) {
+        for(int secretI = 0; secretI < length; secretI++) {
+            if(g[colorI] == s[secretI]) {
+                (*color)++;
+                s[secretI] = colors+1;				//changes the value to avoid incorrect results
+                break;
             }
         }
-        delay(3000);
-        fprintf(stderr, "\n\n-----------------\nStarting Round 1\n-----------------\n\n");
-        game(secret, length, colors, lcd, 0);
-
-    }
-    else{
-        printf("This game mode is not supported\n\n------------------\n\n");
-        main(argc, argv);
     }
+}
 
+// unrolling helpers: PEGS_n(X) expands X(0)..X(n-1), COLORS_n(X) expands X(1)..X(n)
+#define PEGS_4(X)	X(0) X(1) X(2) X(3)
+#define PEGS_5(X)	PEGS_4(X) X(4)
+#define PEGS_6(X)	PEGS_5(X) X(5)
+#define COLORS_6(X)	X(1) X(2) X(3) X(4) X(5) X(6)
+#define COLORS_8(X)	COLORS_6(X) X(7) X(8)
+#define COLORS_9(X)	COLORS_8(X) X(9)
+
+#define HIST_COUNT(i)	hist[pegs[i] & 15]++ ;
+#define SCORE_EXACT(i)	*exact += guess[i] == secret[i] ;
+#define SCORE_MIN(c)	total += gh[c] < sh[c] ? gh[c] : sh[c] ;
+
+// histogramLxC() and scoreLxC() for one configuration, with every loop unrolled
+#define DEFINE_SCORER(L, C)									\
+static void histogram##L##x##C(const int *pegs, int *hist) {					\
+    memset(hist, 0, sizeof(int) * 16);								\
+    PEGS_##L(HIST_COUNT)									\
+}												\
+static void score##L##x##C(const int *guess, const int *secret, int length, int colors, int *exact, int *color) { \
+    int gh[16], sh[16], total = 0;								\
+    histogram##L##x##C(guess, gh);								\
+    histogram##L##x##C(secret, sh);								\
+    *exact = 0;											\
+    PEGS_##L(SCORE_EXACT)									\
+    COLORS_##C(SCORE_MIN)									\
+    *color = total - *exact;									\
 }
 
+DEFINE_SCORER(4, 6)
+DEFINE_SCORER(5, 8)
+DEFINE_SCORER(6, 9)
 
-void game (int *mainSecret, int sequenceLength, int maxColors, struct lcdDataStruct *lcd, int roundNum) //roundNum variable created for the number of attempts
+static const struct
 {
-    int secret[sequenceLength];
-    for(int i = 0; i<sequenceLength; i++) {
-        secret[i] = mainSecret[i];
-    }
+    int length, colors ;
+    gameScoreFn fn ;
+} gameScorers [] =
+{
+    { 4, 6, score4x6 },
+    { 5, 8, score5x8 },
+    { 6, 9, score6x9 },
+} ;
 
-    if (roundNum!=3)		//checks if roundNum does not equal to 3, because the max number of attempts is 3, so the user can keep trying until roundNum=3
-    {
-        int theValue;
+#define GAME_SCORERS	((int)(sizeof(gameScorers) / sizeof(gameScorers[0])))
 
+static gameScoreFn gameScorer = scoreGeneric ;
 
+gameScoreFn pickScorer(int length, int colors) {
+    for (int k = 0; k < GAME_SCORERS; k++) {
+        if (gameScorers[k].length == length && gameScorers[k].colors == colors)
+            return gameScorers[k].fn;
+    }
+    return scoreGeneric;
+}
 
-        // now, start a loop, listening to pinButton and if set pressed, set pinLED
-        int res = 0;
-        int counter = 0;					//stores the number of times the button was pressed
-        int timer = 0;
-        int colors[sequenceLength];				//array to store the input from the user
-        int currentvalue = HIGH;
-        int colorNum;
-        for(colorNum = 0; colorNum <sequenceLength; colorNum++) {
-            fprintf(stderr, "  -----------------\n\n  Starting guess %d\n\n", colorNum+1);
-            while(counter < maxColors) {			//loops until the counter is less than the max number of colours available
-                res = assemblyInput(BUTTON);
-                if((BUTTON & 0xFFFFFFC0) == 0) {
-                    theValue = LOW;				//sets the value to LOW
-
-                    if ((res != 0) && (currentvalue == HIGH)) {
-                        theValue = LOW;
-                        currentvalue = LOW;
-                        counter++;				//only increments if the value has changed from high to low; even if the button has been pressed for 2 seconds the value will only increment by 1
-                        timer = 0;
-                        printf("    Button Pressed\n");
-                    }
-                    else if ((res== 0) && (currentvalue == LOW)) {
-                        theValue = HIGH;
-                        currentvalue = HIGH;
-                    }
-                }
-                else {
-                    fprintf(stderr, "only supporting on-board pins\n");
-                }
-                delay
-                (50);
-                timer++;
+//'b' mode, second half: unrolled against generic scoring on the same random games
+int scorerBenchmark(void) {
+    enum { PAIRS = 4096 };
+    static int guesses[PAIRS][MAX_PEGS], secrets[PAIRS][MAX_PEGS];
 
-                if(timer == 50) {
-                    break;
-                }
-            }
-            printf("\n  End of guess %d\n", colorNum+1);
-            printf("  You pressed the button %d time(s)\n\n", counter);
-            colors[colorNum] = counter;			//adds the counter value to the array
-            blinkRedAssembly(2);			//blinks the red LED once to show that the input has been accepted
-            blinkYellowAssembly((counter*2));		//blinks the Yellow LED the number of times the button was pressed, to echo the input
-            counter = 0;				//counter equals to 0 again to get the next value inputted
-            timer = 0;
-        }
-        printf("  -----------------\n\n-----------------\nEnd of Round %d\n-----------------\n\n", roundNum+1);
-        blinkRedAssembly(4);				//Red LED blinks twice at the end of the users guess
+    for (int k = 0; k < GAME_SCORERS; k++) {
+        int length = gameScorers[k].length, colors = gameScorers[k].colors;
+        double rate[2];
+        int mismatches = 0;
 
-        int exact = 0;
-        int color = 0;
-        for(int colorI = 0; colorI<sequenceLength; colorI++) {		//loops in both arrays and compares values at the same index
-            if(colors[colorI] == secret[colorI]) {			//checks if the values are the same
-                exact++;						//increments exact counter
-                secret[colorI] = maxColors+1;				//changes the secret value to a number that will not be used in the secret so that the comparison doesn't get affected; the results are correct
-                colors[colorI] = maxColors+2;				//changes the color value in the array
+        for (int p = 0; p < PAIRS; p++) {
+            for (int i = 0; i < length; i++) {
+                guesses[p][i] = rand() % colors + 1;
+                secrets[p][i] = rand() % colors + 1;
             }
         }
-
-        for(int colorI = 0; colorI < sequenceLength; colorI++) {				//loops through color array
-            for(int secretI = 0; secretI < sequenceLength; secretI++) {			//loops through secret array
-                if(colors[colorI] == secret[secretI]) {					//checks if the values are the same
-                    color++;								//increments the color counter if the values are the same
-                    secret[secretI] = maxColors+1;					//changes the value to avoid incorrect results
-                    break;
-                }							//once it has been through the first loop then the color index is incremented and the process repeats
-            }
+        for (int v = 0; v < 2; v++) {
+            gameScoreFn fn = v == 0 ? gameScorers[k].fn : scoreGeneric;
+            uint64_t scored = 0, start = monotonicMicros(), elapsed;
+            volatile int sink = 0;
+            do {
+                for (int p = 0; p < PAIRS; p++) {
+                    int exact, color;
+                    fn(guesses[p], secrets[p], length, colors, &exact, &color);
+                    sink += exact + color;
+                }
+                scored += PAIRS;
+                elapsed = monotonicMicros() - start;
+            } while (elapsed < BENCH_MICROS);
+            rate[v] = (double)scored / elapsed;
         }
-        printf("Exact Matches: %d\n", exact);			//prints exact matches on the terminal
-        printf("Color Matches: %d\n", color);			//prints colour matches on the terminal
+        for (int p = 0; p < PAIRS; p++) {
+            int e1, c1, e2, c2;
+            gameScorers[k].fn(guesses[p], secrets[p], length, colors, &e1, &c1);
+            scoreGeneric(guesses[p], secrets[p], length, colors, &e2, &c2);
+            mismatches += e1 != e2 || c1 != c2;
+        }
+        printf("%dx%d game scorer: unrolled %6.1f M/s, generic %6.1f M/s (x%.1f)  %s\n", length, colors,
+               rate[0], rate[1], rate[0] / rate[1], mismatches == 0 ? "ok" : "MISMATCH");
+    }
+    return 0;
+}
+
+/* ***************************************************************************** */
+/* Solver: packed codes, scoring and the advisor's guess selection               */
+
+// feedback of one guess against one secret, packed into a byte
+#define FEEDBACK(exact, color)	((uint8_t)(((exact) << 4) | (color)))
+#define FB_EXACT(fb)		((fb) >> 4)
+#define FB_COLOR(fb)		((fb) & 0x0F)
 
-        lcdClear(lcd) ;						//clears the LCD to allow data to be displayed
+// a code as the solvers see it: pegs, plus how many pegs of each colour (hist[0] unused)
+struct packedCode
+{
+    uint8_t hist [16] ;
+    uint8_t peg [MAX_PEGS] ;
+} ;
 
-        char message1[16];					//array to hold the integer as characters
-        char message2[16];
-        sprintf(message1, "Exact: %d", exact);			//returns the formatted string
-        sprintf(message2, "Color: %d", color);
+// every code of a (length, colors) configuration, in lexicographic order
+struct codeSpace
+{
+    int length, colors ;
+    uint32_t n ;
+    struct packedCode *codes ;
+} ;
 
-        lcdPosition (lcd, 0, 0) ;
-        lcdPuts (lcd, message1) ;		//Displays the string on the LCD, at the positions specified
-        lcdPosition (lcd, 0, 1) ;
-        lcdPuts (lcd, message2) ;
+void packCode(const int *pegs, int length, struct packedCode *out) {
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < length; i++) {
+        out->peg[i] = (uint8_t)pegs[i];
+        out->hist[pegs[i] & 15]++;
+    }
+}
 
-        blinkYellowAssembly(exact*2);		//Yellow LED blinks the number of exact matches
-        blinkRedAssembly(2);			//Red LED blinks once
-        blinkYellowAssembly(color*2);		//Yellow LED blinks the number of colour matches
+//Same result as the nested loops in game(): exact hits, then colours matched elsewhere
+uint8_t scorePacked(const struct packedCode *guess, const struct packedCode *secret, int length) {
+    int exact = 0, total = 0;
+    for (int i = 0; i < length; i++) {
+        exact += guess->peg[i] == secret->peg[i];
+    }
+    for (int c = 1; c < 16; c++) {
+        total += guess->hist[c] < secret->hist[c] ? guess->hist[c] : secret->hist[c];
+    }
+    return FEEDBACK(exact, total - exact);
+}
 
+//Lists all colors^length codes; returns FALSE if the configuration is beyond the solvers
+int codeSpaceInit(struct codeSpace *sp, int length, int colors) {
+    if (length < 1 || length > MAX_PEGS || colors < 1 || colors > MAX_COLORS)
+        return FALSE;
+    uint64_t n = 1;
+    for (int i = 0; i < length; i++) {
+        n *= colors;
+        if (n > SOLVER_MAX_CODES)
+            return FALSE;
+    }
 
+    sp->length = length;
+    sp->colors = colors;
+    sp->n = (uint32_t)n;
+    sp->codes = malloc(sizeof(struct packedCode) * n);
+    if (sp->codes == NULL)
+        return FALSE;
 
-        roundNum++;				//roundNum values gets incremented
-        if(exact != sequenceLength) {		//checks if the exact matches equals the length of the secret, because if it does not then the guess was incorrect
-            blinkRedAssembly(6);		//blink Red LED 3 times to show end of round
-            printf("\n-----------------\nStarting Round %d\n-----------------\n\n", roundNum+1);
-            game(mainSecret, sequenceLength, maxColors, lcd, roundNum);		//starts the next round
+    int pegs[MAX_PEGS];
+    for (int i = 0; i < length; i++) {
+        pegs[i] = 1;
+    }
+    for (uint32_t k = 0; k < sp->n; k++) {
+        packCode(pegs, length, &sp->codes[k]);
+        for (int i = length-1; i >= 0 && ++pegs[i] > colors; i--) {	//odometer, last peg fastest
+            pegs[i] = 1;
         }
-        else {					//if the exact matches is equal to the length then the guess is correct and game ends
-            blinkRedAssembly(1);			//turns the LED on
-            blinkYellowAssembly(6);			//blinks the Yellow LED 3 times
+    }
+    return TRUE;
+}
+
+/* ----------------------*/
+/* batch scoring: one guess against n packed codes, out[i] = feedback for codes[i]. */
+/* Colour matches are the byte-wise min of the two histograms summed up, exact hits */
+/* a byte compare of the pegs, so both map onto 16-byte vectors. The kernel is      */
+/* picked at run time from what the CPU supports.                                   */
+
+typedef void (*scoreManyFn) (const struct packedCode *guess, const struct packedCode *codes, uint32_t n, int length, uint8_t *out) ;
+
+static void scoreManyScalar(const struct packedCode *guess, const struct packedCode *codes, uint32_t n, int length, uint8_t *out) {
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = scorePacked(guess, &codes[i], length);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse4.2,popcnt")))
+static void scoreManySse42(const struct packedCode *guess, const struct packedCode *codes, uint32_t n, int length, uint8_t *out) {
+    __m128i gh = _mm_loadu_si128((const __m128i *)guess->hist);
+    __m128i gp = _mm_loadl_epi64((const __m128i *)guess->peg);
+    unsigned live = (1u << length) - 1;				//peg bytes that take part in the compare
+
+    for (uint32_t i = 0; i < n; i++) {
+        __m128i sum = _mm_sad_epu8(_mm_min_epu8(gh, _mm_loadu_si128((const __m128i *)codes[i].hist)), _mm_setzero_si128());
+        int total = _mm_cvtsi128_si32(sum) + _mm_extract_epi16(sum, 4);
+        __m128i eq = _mm_cmpeq_epi8(gp, _mm_loadl_epi64((const __m128i *)codes[i].peg));
+        int exact = _mm_popcnt_u32(_mm_movemask_epi8(eq) & live);
+        out[i] = FEEDBACK(exact, total - exact);
+    }
+}
+
+//four codes per iteration: two histograms per 256-bit register, the four peg rows in one
+__attribute__((target("avx2")))
+static void scoreManyAvx2(const struct packedCode *guess, const struct packedCode *codes, uint32_t n, int length, uint8_t *out) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i gather = _mm256_setr_epi8(0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i gh = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)guess->hist));
+    uint64_t pegs, live = 0;
+    memcpy(&pegs, guess->peg, sizeof(pegs));
+    for (int k = 0; k < length; k++) {
+        live |= (uint64_t)1 << (8*k);				//a 1 in every peg byte that takes part
+    }
+    __m256i gp = _mm256_set1_epi64x((long long)pegs);
+    __m256i ones = _mm256_set1_epi64x((long long)live);
+    uint32_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        const struct packedCode *c = &codes[i];
+        __m256i h01 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)c[0].hist)),
+                                              _mm_loadu_si128((const __m128i *)c[1].hist), 1);
+        __m256i h23 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)c[2].hist)),
+                                              _mm_loadu_si128((const __m128i *)c[3].hist), 1);
+        __m256i s01 = _mm256_sad_epu8(_mm256_min_epu8(gh, h01), zero);
+        __m256i s23 = _mm256_sad_epu8(_mm256_min_epu8(gh, h23), zero);
+        s01 = _mm256_add_epi64(s01, _mm256_bsrli_epi128(s01, 8));	//totals of codes 0,1 in qwords 0,2
+        s23 = _mm256_add_epi64(s23, _mm256_bsrli_epi128(s23, 8));	//totals of codes 2,3 in qwords 0,2
+        __m256i total = _mm256_blend_epi32(s01, _mm256_bslli_epi128(s23, 8), 0xCC);
+        total = _mm256_permute4x64_epi64(total, _MM_SHUFFLE(3, 1, 2, 0));
+
+        uint64_t p[4];
+        for (int k = 0; k < 4; k++) {
+            memcpy(&p[k], c[k].peg, sizeof(p[k]));
+        }
+        __m256i eq = _mm256_cmpeq_epi8(gp, _mm256_set_epi64x((long long)p[3], (long long)p[2], (long long)p[1], (long long)p[0]));
+        __m256i exact = _mm256_sad_epu8(_mm256_and_si256(eq, ones), zero);
+
+        __m256i fb = _mm256_or_si256(_mm256_slli_epi64(exact, 4), _mm256_sub_epi64(total, exact));
+        fb = _mm256_shuffle_epi8(fb, gather);
+        uint32_t four = (uint32_t)_mm256_extract_epi16(fb, 0) | (uint32_t)_mm256_extract_epi16(fb, 8) << 16;
+        memcpy(out + i, &four, sizeof(four));
+    }
+    scoreManyScalar(guess, codes + i, n - i, length, out + i);
+}
+
+static int hasSse42(void) { return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"); }
+static int hasAvx2(void)  { return __builtin_cpu_supports("avx2"); }
+#endif
+
+#ifdef SCORE_NEON
+NEON_TARGET
+static void scoreManyNeon(const struct packedCode *guess, const struct packedCode *codes, uint32_t n, int length, uint8_t *out) {
+    static const uint8_t ones[16] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+    uint8x16_t gh = vld1q_u8(guess->hist);
+    uint8x8_t gp = vld1_u8(guess->peg);
+    uint8x8_t live = vld1_u8(ones + 8 - length);		//1 for the first length pegs, 0 after
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint8x16_t h = vminq_u8(gh, vld1q_u8(codes[i].hist));
+        uint8x8_t eq = vand_u8(vceq_u8(gp, vld1_u8(codes[i].peg)), live);
+#ifdef __aarch64__
+        int total = vaddvq_u8(h);
+        int exact = vaddv_u8(eq);
+#else
+        uint64x2_t t = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(h)));
+        int total = (int)(vgetq_lane_u64(t, 0) + vgetq_lane_u64(t, 1));
+        int exact = (int)vget_lane_u64(vpaddl_u32(vpaddl_u16(vpaddl_u8(eq))), 0);
+#endif
+        out[i] = FEEDBACK(exact, total - exact);
+    }
+}
+
+static int hasNeon(void) {
+#ifdef __aarch64__
+    return TRUE;
+#else
+    return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+}
+#endif
+
+// fastest first; the scalar kernel is always there
+static const struct
+{
+    const char *name ;
+    scoreManyFn fn ;
+    int (*available) (void) ;
+} scoreKernels [] =
+{
+#if defined(__x86_64__) || defined(__i386__)
+    { "avx2",   scoreManyAvx2,   hasAvx2  },
+    { "sse4.2", scoreManySse42,  hasSse42 },
+#endif
+#ifdef SCORE_NEON
+    { "neon",   scoreManyNeon,   hasNeon  },
+#endif
+    { "scalar", scoreManyScalar, NULL     },
+} ;
+
+#define SCORE_KERNELS	((int)(sizeof(scoreKernels) / sizeof(scoreKernels[0])))
+
+static scoreManyFn scoreManyKernel ;
+
+void scoreMany(const struct packedCode *guess, const struct packedCode *codes, uint32_t n, int length, uint8_t *out) {
+    if (scoreManyKernel == NULL) {
+        int k = 0;
+        while (scoreKernels[k].available != NULL && !scoreKernels[k].available())
+            k++;
+        scoreManyKernel = scoreKernels[k].fn;
+    }
+    scoreManyKernel(guess, codes, n, length, out);
+}
+
+//'b' mode: scores per second for every kernel this CPU can run, checked against the scalar one
+int scoreBenchmark(void) {
+    static const int configs[][2] = { { 4, 6 }, { 5, 8 }, { 6, 9 } };
+
+    for (int c = 0; c < 3; c++) {
+        struct codeSpace sp;
+        if (!codeSpaceInit(&sp, configs[c][0], configs[c][1]))
+            continue;
+        uint8_t *expect = malloc(sp.n), *got = malloc(sp.n);
+        const struct packedCode *guess = &sp.codes[sp.n / 3];
+        scoreManyScalar(guess, sp.codes, sp.n, sp.length, expect);
+
+        printf("%dx%d, %u codes\n", sp.length, sp.colors, sp.n);
+        for (int k = 0; k < SCORE_KERNELS; k++) {
+            if (scoreKernels[k].available != NULL && !scoreKernels[k].available())
+                continue;
+            uint64_t scored = 0, start = monotonicMicros(), elapsed;
+            do {
+                scoreKernels[k].fn(guess, sp.codes, sp.n, sp.length, got);
+                scored += sp.n;
+                elapsed = monotonicMicros() - start;
+            } while (elapsed < BENCH_MICROS);
+            printf("  %-8s %8.1f Mscores/s  %s\n", scoreKernels[k].name, (double)scored / elapsed,
+                   memcmp(got, expect, sp.n) == 0 ? "ok" : "MISMATCH");
+        }
+        free(expect);
+        free(got);
+        free(sp.codes);
+    }
+    return 0;
+}
+
+/* ----------------------*/
+/* symmetry reduction: guesses the history can't tell apart score alike against the */
+/* candidates, so a search only needs one of each. Colours no past guess used may  */
+/* be swapped for each other, and so may positions that every past guess coloured  */
+/* the same. A code represents its class if no such relabelling makes it smaller.  */
+
+struct symmetry
+{
+    int length ;
+    uint8_t untouched [16] ;				// colours no past guess used, ascending
+    int nu ;
+    int nperms ;					// position permutations kept in perms
+    uint8_t (*perms)[MAX_PEGS] ;
+} ;
+
+//All permutations moving positions only within their class, or just the identity past SYMMETRY_MAX_PERMS
+static void symmetryPerms(struct symmetry *sym, const int *cls, int pos, uint8_t *perm, int used) {
+    if (pos == sym->length) {
+        if (sym->nperms < SYMMETRY_MAX_PERMS)
+            memcpy(sym->perms[sym->nperms], perm, MAX_PEGS);
+        sym->nperms++;
+        return;
+    }
+    for (int j = 0; j < sym->length; j++) {
+        if (cls[j] == cls[pos] && !((used >> j) & 1)) {
+            perm[pos] = j;
+            symmetryPerms(sym, cls, pos + 1, perm, used | (1 << j));
+        }
+    }
+}
+
+void symmetryInit(struct symmetry *sym, const struct codeSpace *sp, const struct packedCode *history, int rounds) {
+    int cls[MAX_PEGS];
+    uint8_t perm[MAX_PEGS] = { 0 };
+
+    sym->length = sp->length;
+    sym->nu = 0;
+    for (int c = 1; c <= sp->colors; c++) {
+        int used = FALSE;
+        for (int r = 0; r < rounds; r++) {
+            used |= history[r].hist[c] != 0;
+        }
+        if (!used)
+            sym->untouched[sym->nu++] = c;
+    }
+    for (int i = 0; i < sp->length; i++) {			//class = first position with the same column of past pegs
+        cls[i] = i;
+        for (int j = 0; j < i && cls[i] == i; j++) {
+            int same = TRUE;
+            for (int r = 0; r < rounds; r++) {
+                same &= history[r].peg[i] == history[r].peg[j];
+            }
+            if (same)
+                cls[i] = j;
+        }
+    }
+
+    sym->perms = malloc(SYMMETRY_MAX_PERMS * MAX_PEGS);
+    sym->nperms = 0;
+    symmetryPerms(sym, cls, 0, perm, 0);
+    if (sym->nperms > SYMMETRY_MAX_PERMS) {			//too many to try: colour relabelling only
+        for (int i = 0; i < MAX_PEGS; i++) {
+            sym->perms[0][i] = i;
+        }
+        sym->nperms = 1;
+    }
+}
+
+//Compares pegs (permuted by perm, untouched colours renamed in order of appearance) with code
+static int symmetryCompare(const struct symmetry *sym, const uint8_t *pegs, const uint8_t *perm, const uint8_t *code) {
+    uint8_t rename[16] = { 0 };
+    int next = 0;
+    for (int i = 0; i < sym->length; i++) {
+        uint8_t c = pegs[perm[i]];
+        for (int u = 0; u < sym->nu; u++) {
+            if (sym->untouched[u] == c) {
+                if (rename[c] == 0)
+                    rename[c] = sym->untouched[next++];
+                c = rename[c];
+                break;
+            }
+        }
+        if (c != code[i])
+            return c < code[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+//Writes one guess per class to reps (room for sp->n) and returns how many there are
+uint32_t symmetryReduce(const struct codeSpace *sp, const struct packedCode *history, int rounds, struct packedCode *reps) {
+    struct symmetry sym;
+    uint32_t n = 0;
+
+    symmetryInit(&sym, sp, history, rounds);
+    for (uint32_t k = 0; k < sp->n; k++) {
+        const uint8_t *pegs = sp->codes[k].peg;
+        int smallest = symmetryCompare(&sym, pegs, sym.perms[0], pegs) == 0;	//identity: colours already in order
+        for (int p = 1; p < sym.nperms && smallest; p++) {
+            smallest = symmetryCompare(&sym, pegs, sym.perms[p], pegs) >= 0;
+        }
+        if (smallest)
+            reps[n++] = sp->codes[k];
+    }
+    free(sym.perms);
+    return n;
+}
+
+//Keeps the candidates that would have produced feedback fb for guess; returns how many are left
+uint32_t filterCandidates(struct packedCode *cands, uint32_t nc, const struct packedCode *guess, uint8_t fb, int length) {
+    uint8_t *fbs = malloc(nc + 1);
+    uint32_t kept = 0;
+    scoreMany(guess, cands, nc, length, fbs);
+    for (uint32_t i = 0; i < nc; i++) {
+        if (fbs[i] == fb)
+            cands[kept++] = cands[i];
+    }
+    free(fbs);
+    return kept;
+}
+
+//Minimax over pool (every step-th guess): the guess whose worst feedback leaves the fewest
+//candidates, preferring guesses that could still be the secret. Returns that worst case.
+static uint32_t minimaxGuess(const struct packedCode *pool, uint32_t poolSize, uint32_t step,
+                             const struct packedCode *cands, uint32_t nc, int length, struct packedCode *out) {
+    uint8_t solved = FEEDBACK(length, 0);
+    uint32_t bestWorst = UINT32_MAX;
+    int bestConsistent = FALSE;
+    uint8_t *fbs = malloc(nc);
+
+    for (uint32_t p = 0; p < poolSize; p += step) {
+        uint32_t count[256] = { 0 };
+        uint32_t worst = 0;
+        scoreMany(&pool[p], cands, nc, length, fbs);
+        for (uint32_t i = 0; i < nc; i++) {
+            count[fbs[i]]++;
+        }
+        for (int fb = 0; fb < 256; fb++) {
+            if (count[fb] > worst) worst = count[fb];
+        }
+        int consistent = count[solved] != 0;
+        if (worst < bestWorst || (worst == bestWorst && consistent && !bestConsistent)) {
+            bestWorst = worst;
+            bestConsistent = consistent;
+            *out = pool[p];
+        }
+    }
+    free(fbs);
+    return bestWorst;
+}
+
+//Picks the advisor's next guess (Knuth's minimax) given the guesses played so far. The whole
+//code space, cut down to one guess per symmetry class, is searched when that fits in
+//ADVISOR_WORK scorings, otherwise the candidates themselves (thinned out evenly if needed).
+void chooseGuess(const struct codeSpace *sp, const struct packedCode *history, int rounds,
+                 const struct packedCode *cands, uint32_t nc, struct packedCode *out) {
+    if (nc <= 2) {
+        *out = cands[0];
+        return;
+    }
+
+    struct packedCode *reps = malloc(sizeof(struct packedCode) * sp->n);
+    uint32_t nr = symmetryReduce(sp, history, rounds, reps);
+    if ((uint64_t)nr * nc <= ADVISOR_WORK) {
+        minimaxGuess(reps, nr, 1, cands, nc, sp->length, out);
+    }
+    else {
+        uint32_t step = (uint32_t)((uint64_t)nc * nc / ADVISOR_WORK) + 1;
+        minimaxGuess(cands, nc, step, cands, nc, sp->length, out);
+    }
+    free(reps);
+}
+
+//'b' mode, symmetry check: the reduced search must find a guess as good as the full one
+int symmetryCheck(void) {
+    static const int configs[][2] = { { 4, 6 }, { 5, 8 } };
+    struct packedCode history[2], best;
+
+    for (int c = 0; c < 2; c++) {
+        struct codeSpace sp;
+        if (!codeSpaceInit(&sp, configs[c][0], configs[c][1]))
+            continue;
+        struct packedCode *cands = malloc(sizeof(struct packedCode) * sp.n);
+        struct packedCode *reps = malloc(sizeof(struct packedCode) * sp.n);
+
+        for (int rounds = 0; rounds <= 2; rounds++) {
+            uint32_t nc = sp.n;
+            memcpy(cands, sp.codes, sizeof(struct packedCode) * nc);
+            for (int r = 0; r < rounds; r++) {		//a random guess against a random secret
+                history[r] = sp.codes[rand() % sp.n];
+                nc = filterCandidates(cands, nc, &history[r], scorePacked(&history[r], &sp.codes[rand() % sp.n], sp.length), sp.length);
+            }
+            if ((uint64_t)sp.n * nc > 16 * (uint64_t)ADVISOR_WORK)
+                continue;
+
+            uint32_t nr = symmetryReduce(&sp, history, rounds, reps);
+            uint64_t start = monotonicMicros();
+            uint32_t fullWorst = minimaxGuess(sp.codes, sp.n, 1, cands, nc, sp.length, &best);
+            uint64_t mid = monotonicMicros();
+            uint32_t reducedWorst = minimaxGuess(reps, nr, 1, cands, nc, sp.length, &best);
+            uint64_t end = monotonicMicros();
+            printf("%dx%d after %d guesses: %u candidates, %u guesses -> %u classes, worst case %u vs %u (%.1f vs %.1f ms)  %s\n",
+                   sp.length, sp.colors, rounds, nc, sp.n, nr, fullWorst, reducedWorst,
+                   (mid - start) / 1e3, (end - mid) / 1e3, fullWorst == reducedWorst ? "ok" : "MISMATCH");
+        }
+        free(reps);
+        free(cands);
+        free(sp.codes);
+    }
+    return 0;
+}
+
+/* ***************************************************************************** */
+/* Strategy cache: the advisor's decision tree, mmap'ed from disk                */
+/* The file is a header followed by a flat array of nodes. A node holds the      */
+/* recommended guess and one child index per feedback, (exact*(length+1)+color), */
+/* for the position reached after that feedback. Index 0 is the root, so a 0     */
+/* child means "not cached yet". Following a game's feedback from the root costs */
+/* one array lookup per round; anything missing is computed live and appended.   */
+
+#define STRATEGY_MAGIC	0x4D4D5354			// "MMST"
+#define STRATEGY_VERSION 1
+
+struct strategyHeader
+{
+    uint32_t magic, version ;
+    int32_t length, colors ;
+    uint32_t slots ;					// children per node, (length+1)^2
+    uint32_t nodes, capacity ;
+} ;
+
+struct strategyTree
+{
+    int fd ;
+    size_t size ;
+    struct strategyHeader *h ;
+} ;
+
+static size_t strategyNodeSize(uint32_t slots) {
+    return MAX_PEGS + sizeof(uint32_t) * slots;
+}
+
+static uint8_t *strategyGuess(const struct strategyTree *t, uint32_t node) {
+    return (uint8_t *)(t->h + 1) + (size_t)node * strategyNodeSize(t->h->slots);
+}
+
+static uint32_t *strategyChildren(const struct strategyTree *t, uint32_t node) {
+    return (uint32_t *)(strategyGuess(t, node) + MAX_PEGS);
+}
+
+static int strategySlot(int length, uint8_t fb) {
+    return FB_EXACT(fb) * (length+1) + FB_COLOR(fb);
+}
+
+//Maps room for capacity nodes, growing the file if needed
+static int strategyMap(struct strategyTree *t, uint32_t slots, uint32_t capacity) {
+    size_t size = sizeof(struct strategyHeader) + strategyNodeSize(slots) * capacity;
+    if (t->h != NULL)
+        munmap(t->h, t->size);
+    t->h = NULL;
+    if (ftruncate(t->fd, size) < 0)
+        return FALSE;
+    void *p = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, t->fd, 0);
+    if (p == MAP_FAILED)
+        return FALSE;
+    t->h = (struct strategyHeader *)p;
+    t->size = size;
+    return TRUE;
+}
+
+void strategyClose(struct strategyTree *t) {
+    if (t->h != NULL)
+        munmap(t->h, t->size);
+    if (t->fd >= 0)
+        close(t->fd);
+    t->h = NULL;
+    t->fd = -1;
+}
+
+//Nodes the current mapping has room for
+static uint32_t strategyMapped(const struct strategyTree *t) {
+    return (t->size - sizeof(struct strategyHeader)) / strategyNodeSize(t->h->slots);
+}
+
+//Takes the file lock (LOCK_SH to read, LOCK_EX to append; LOCK_NB so a game never waits on ./t g)
+//and follows any growth by another process. FALSE, unlocked, if the lock or the mapping fails
+static int strategyLock(struct strategyTree *t, int how) {
+    if (t->h == NULL || flock(t->fd, how) < 0)
+        return FALSE;
+    if (t->h->capacity > strategyMapped(t) && !strategyMap(t, t->h->slots, t->h->capacity)) {
+        flock(t->fd, LOCK_UN);
+        return FALSE;
+    }
+    if (t->h->nodes > t->h->capacity) {
+        fprintf(stderr, "strategy: cache is corrupt, ignoring it\n");
+        flock(t->fd, LOCK_UN);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void strategyUnlock(struct strategyTree *t) {
+    flock(t->fd, LOCK_UN);
+}
+
+//Maps a valid cache, or starts an empty one if the file is missing or stale; called with the lock held
+static int strategyLoad(struct strategyTree *t, const char *path, int length, int colors) {
+    struct stat st;
+    uint32_t slots = (length+1) * (length+1);
+
+    if (fstat(t->fd, &st) < 0) {
+        fprintf(stderr, "strategy: cannot open %s: %s\n", path, strerror(errno));
+        return FALSE;
+    }
+    if ((size_t)st.st_size >= sizeof(struct strategyHeader)) {
+        struct strategyHeader *h = mmap(0, st.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, t->fd, 0);
+        if (h != MAP_FAILED && h->magic == STRATEGY_MAGIC && h->version == STRATEGY_VERSION
+            && h->length == length && h->colors == colors && h->slots == slots && h->nodes <= h->capacity
+            && sizeof(struct strategyHeader) + strategyNodeSize(slots) * h->capacity <= (size_t)st.st_size) {
+            t->h = h;
+            t->size = st.st_size;
+            return TRUE;
+        }
+        if (h != MAP_FAILED)
+            munmap(h, st.st_size);
+    }
+
+    if (!strategyMap(t, slots, STRATEGY_INITIAL_NODES)) {
+        fprintf(stderr, "strategy: cannot map %s: %s\n", path, strerror(errno));
+        return FALSE;
+    }
+    memset(t->h, 0, t->size);
+    t->h->magic    = STRATEGY_MAGIC;
+    t->h->version  = STRATEGY_VERSION;
+    t->h->length   = length;
+    t->h->colors   = colors;
+    t->h->slots    = slots;
+    t->h->capacity = STRATEGY_INITIAL_NODES;
+    return TRUE;
+}
+
+//Opens the cache for a configuration; the check (and any reset) of the file happens under its lock
+int strategyOpen(struct strategyTree *t, const char *path, int length, int colors) {
+    t->h = NULL;
+    t->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (t->fd < 0 || flock(t->fd, LOCK_EX) < 0) {
+        fprintf(stderr, "strategy: cannot open %s: %s\n", path, strerror(errno));
+        strategyClose(t);
+        return FALSE;
+    }
+    int ok = strategyLoad(t, path, length, colors);
+    strategyUnlock(t);
+    if (!ok)
+        strategyClose(t);
+    return ok;
+}
+
+//Adds a node (without children) and hooks it under parent/slot; returns its index. If the file
+//can't grow (e.g. the card is full) the cache is dropped: t->h is NULL afterwards and 0 is returned
+uint32_t strategyAppend(struct strategyTree *t, const struct packedCode *guess, uint32_t parent, int slot) {
+    uint32_t node = t->h->nodes;
+    if (node == t->h->capacity) {
+        uint32_t slots = t->h->slots, capacity = 2 * node;
+        if (!strategyMap(t, slots, capacity)) {
+            fprintf(stderr, "strategy: cannot grow cache: %s\n", strerror(errno));
+            return 0;
+        }
+        t->h->capacity = capacity;
+    }
+    memcpy(strategyGuess(t, node), guess->peg, MAX_PEGS);
+    memset(strategyChildren(t, node), 0, sizeof(uint32_t) * t->h->slots);
+    if (node != 0 && parent < node)				//parent is gone if ./t g restarted the file meanwhile
+        strategyChildren(t, parent)[slot] = node;
+    t->h->nodes = node + 1;
+    return node;
+}
+
+static void strategyPath(char *path, size_t size, int length, int colors) {
+    snprintf(path, size, STRATEGY_FILE, length, colors);
+}
+
+//Offline generation: caches the full tree below parent/slot for MAX_ROUNDS-depth more rounds
+static void strategyGrow(struct strategyTree *t, const struct codeSpace *sp, const struct packedCode *cands, uint32_t nc,
+                         struct packedCode *path, uint32_t parent, int slot, int depth) {
+    struct packedCode guess;
+    chooseGuess(sp, path, depth, cands, nc, &guess);
+    path[depth] = guess;
+    uint32_t node = strategyAppend(t, &guess, parent, slot);
+    if (t->h == NULL || depth+1 >= MAX_ROUNDS)
+        return;
+
+    uint8_t *fbs = malloc(nc);
+    struct packedCode *sub = malloc(sizeof(struct packedCode) * nc);
+    scoreMany(&guess, cands, nc, sp->length, fbs);
+    for (int e = 0; e < sp->length; e++) {			//all exact means solved, nothing to cache below it
+        for (int c = 0; e + c <= sp->length; c++) {
+            uint32_t ns = 0;
+            for (uint32_t i = 0; i < nc; i++) {
+                if (fbs[i] == FEEDBACK(e, c))
+                    sub[ns++] = cands[i];
+            }
+            if (ns != 0 && t->h != NULL)
+                strategyGrow(t, sp, sub, ns, path, node, e*(sp->length+1) + c, depth+1);
+        }
+    }
+    free(sub);
+    free(fbs);
+}
+
+//'g' mode: builds the decision tree for a configuration ahead of time
+int strategyGenerate(int length, int colors) {
+    struct codeSpace sp;
+    struct strategyTree t;
+    struct packedCode path[MAX_ROUNDS];
+    char file[64];
+
+    if (!codeSpaceInit(&sp, length, colors))
+        return failure(TRUE, "strategy: %dx%d is too large for the solver\n", length, colors);
+    strategyPath(file, sizeof(file), length, colors);
+    if (!strategyOpen(&t, file, length, colors) || !strategyLock(&t, LOCK_EX))
+        return failure(TRUE, "strategy: generation of %s aborted\n", file);
+
+    t.h->nodes = 0;						//regenerate from scratch; running games skip the cache meanwhile
+    strategyGrow(&t, &sp, sp.codes, sp.n, path, 0, 0, 0);
+    if (t.h == NULL)
+        return failure(TRUE, "strategy: generation of %s aborted\n", file);
+    printf("Wrote %u nodes to %s\n", t.h->nodes, file);
+
+    strategyUnlock(&t);
+    strategyClose(&t);
+    free(sp.codes);
+    return 0;
+}
+
+/* ----------------------*/
+/* the advisor used by game(): a walk down the cached tree, or live computation */
+
+struct advisorState
+{
+    int active ;
+    struct codeSpace space ;
+    struct strategyTree tree ;
+    int rounds ;					// history so far
+    struct packedCode guesses [MAX_ROUNDS] ;
+    uint8_t feedbacks [MAX_ROUNDS] ;
+    int onTree ;					// every guess so far was the tree's advice
+    uint32_t node, parent ;				// node == 0 after round 1 means "missing under parent/slot"
+    int slot ;
+} ;
+
+static struct advisorState advisor ;
+static int hintMode ;					// print the advisor's guess every round
+static int roundLimit = MAX_ROUNDS ;			// guesses allowed in a game
+
+void advisorStart(int length, int colors) {
+    char path[64];
+
+    memset(&advisor, 0, sizeof(advisor));
+    advisor.tree.fd = -1;
+    if (!codeSpaceInit(&advisor.space, length, colors)) {
+        fprintf(stderr, "advisor: %dx%d is too large, no hints\n", length, colors);
+        return;
+    }
+    strategyPath(path, sizeof(path), length, colors);
+    strategyOpen(&advisor.tree, path, length, colors);
+    advisor.active = TRUE;
+    advisor.onTree = TRUE;
+}
+
+//Recommended next guess for the history so far; FALSE if there is no advisor for this game
+int advisorSuggest(int *pegs) {
+    struct strategyTree *t = &advisor.tree;
+    struct codeSpace *sp = &advisor.space;
+    struct packedCode guess;
+    if (!advisor.active)
+        return FALSE;
+
+    int cached = FALSE;
+    if (advisor.onTree && strategyLock(t, LOCK_SH | LOCK_NB)) {
+        cached = (advisor.rounds == 0 ? t->h->nodes > 0 : advisor.node != 0) && advisor.node < t->h->nodes;
+        if (cached)
+            memcpy(guess.peg, strategyGuess(t, advisor.node), MAX_PEGS);
+        strategyUnlock(t);
+    }
+    else {
+        advisor.onTree = FALSE;					//no cache, or busy being generated: live hints
+    }
+
+    if (!cached) {
+        struct packedCode *cands = malloc(sizeof(struct packedCode) * sp->n);
+        uint32_t nc = sp->n;
+        memcpy(cands, sp->codes, sizeof(struct packedCode) * nc);
+        for (int r = 0; r < advisor.rounds; r++) {
+            nc = filterCandidates(cands, nc, &advisor.guesses[r], advisor.feedbacks[r], sp->length);
+        }
+        guess = sp->codes[0];
+        if (nc != 0)
+            chooseGuess(sp, advisor.guesses, advisor.rounds, cands, nc, &guess);
+        free(cands);
+
+        if (advisor.onTree && strategyLock(t, LOCK_EX | LOCK_NB)) {
+            advisor.node = strategyAppend(t, &guess, advisor.parent, advisor.slot);
+            strategyUnlock(t);
+        }
+        if (t->h == NULL)
+            advisor.onTree = FALSE;				//no cache to write to: keep giving live hints
+    }
+
+    for (int i = 0; i < sp->length; i++) {
+        pegs[i] = guess.peg[i];
+    }
+    return TRUE;
+}
+
+//Records the guess actually played and its feedback, and follows the tree if it was the advice
+void advisorUpdate(const int *pegs, int exact, int color) {
+    struct strategyTree *t = &advisor.tree;
+    if (!advisor.active || advisor.rounds == MAX_ROUNDS)
+        return;
+
+    struct packedCode *guess = &advisor.guesses[advisor.rounds];
+    uint8_t fb = FEEDBACK(exact, color);
+    packCode(pegs, advisor.space.length, guess);
+    advisor.feedbacks[advisor.rounds++] = fb;
+
+    if (!advisor.onTree || !strategyLock(t, LOCK_SH | LOCK_NB)) {
+        advisor.onTree = FALSE;
+        return;
+    }
+    if (t->h->nodes == 0 || advisor.node >= t->h->nodes
+        || (advisor.rounds > 1 && advisor.node == 0)
+        || memcmp(strategyGuess(t, advisor.node), guess->peg, MAX_PEGS) != 0) {
+        advisor.onTree = FALSE;					//off the cached path: later hints are live
+        strategyUnlock(t);
+        return;
+    }
+    advisor.parent = advisor.node;
+    advisor.slot = strategySlot(advisor.space.length, fb);
+    advisor.node = strategyChildren(t, advisor.parent)[advisor.slot];
+    if (advisor.node >= t->h->nodes)
+        advisor.node = 0;					//a bad child counts as missing and gets replaced
+    strategyUnlock(t);
+}
+
+/* ***************************************************************************** */
+/* Evil secret keeper (mode 3): no secret is chosen up front. Every guess splits */
+/* the codes still consistent with the answers given so far by feedback, and the */
+/* keeper answers with the feedback of the largest group; a secret only gets     */
+/* fixed when the player has pinned it down (or is out of attempts).             */
+
+struct evilState
+{
+    int active, verbose ;
+    struct codeSpace space ;
+    struct packedCode *cands ;				// codes consistent with every answer so far
+    uint32_t nc ;
+    uint8_t *fbs ;
+} ;
+
+static struct evilState evil ;
+
+//FALSE if the configuration is too large to keep every possible secret around
+int evilStart(int length, int colors, int verbose) {
+    if (!codeSpaceInit(&evil.space, length, colors))
+        return FALSE;
+    evil.cands = evil.space.codes;				//nothing ruled out yet, filtered in place from here on
+    evil.nc = evil.space.n;
+    evil.fbs = malloc(evil.nc);
+    evil.verbose = verbose;
+    evil.active = TRUE;
+    return TRUE;
+}
+
+//Answers a guess with the feedback that leaves the most secrets open
+void evilRespond(const int *guess, int length, int *exact, int *color) {
+    struct packedCode g;
+    uint32_t count[256] = { 0 };
+    uint64_t start = monotonicMicros();
+    int best = -1;
+
+    packCode(guess, length, &g);
+    scoreMany(&g, evil.cands, evil.nc, length, evil.fbs);		//one streaming pass gives every partition size
+    for (uint32_t i = 0; i < evil.nc; i++) {
+        count[evil.fbs[i]]++;
+    }
+    for (int fb = 0; fb < 256; fb++) {				//ties go to the answer with fewer exact hits
+        if (count[fb] != 0 && (best < 0 || count[fb] > count[best]))
+            best = fb;
+    }
+
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < evil.nc; i++) {
+        if (evil.fbs[i] == best)
+            evil.cands[kept++] = evil.cands[i];
+    }
+    evil.nc = kept;
+    *exact = FB_EXACT(best);
+    *color = FB_COLOR(best);
+
+    if (evil.verbose)
+        printf("  (%u possible secrets left, answered in %.1f ms)\n", evil.nc, (monotonicMicros() - start) / 1e3);
+}
+
+//The game is over: commit to one of the secrets still consistent with every answer
+void evilSettle(int *secret, int length) {
+    const struct packedCode *c = &evil.cands[rand() % evil.nc];
+    for (int i = 0; i < length; i++) {
+        secret[i] = c->peg[i];
+    }
+}
+
+/* ***************************************************************************** */
+/* Multi-secret game (mode 4): the keeper holds K secrets and every guess is     */
+/* scored against all of them. Hints track one candidate set per secret as a     */
+/* bitmask per code, so a round costs one scoreMany over the secrets and one     */
+/* over the code space however large K is.                                       */
+
+struct multiState
+{
+    int active, k ;
+    int length, colors ;
+    struct packedCode secrets [MULTI_MAX_SECRETS] ;
+    uint32_t solved ;					// bit k: secret k has been guessed
+    uint8_t fb [MULTI_MAX_SECRETS] ;			// this round's feedback per secret
+    int tracking ;					// candidate sets kept for hints
+    struct codeSpace space ;
+    uint16_t *alive ;					// bit k: the code may still be secret k
+    uint8_t *fbs ;
+    uint32_t left [MULTI_MAX_SECRETS] ;
+    int rounds ;
+    struct packedCode played [MULTI_MAX_SECRETS + MULTI_EXTRA_ROUNDS] ;
+    struct lcdDataStruct *lcd ;				// screens cycle from readPeg() while the next guess is entered
+    int screen ;					// 0: summary, s+1: secret s
+    uint64_t shownAt ;					// ms
+} ;
+
+static struct multiState multi ;
+
+//FALSE if the configuration can't be packed
+int multiStart(int length, int colors, int k, int withHints) {
+    int pegs[MAX_PEGS];
+    if (length < 1 || length > MAX_PEGS || colors < 1 || colors > MAX_COLORS || k < 1 || k > MULTI_MAX_SECRETS)
+        return FALSE;
+
+    multi.k = k;
+    multi.length = length;
+    multi.colors = colors;
+    for (int s = 0; s < k; s++) {
+        for (int i = 0; i < length; i++) {
+            pegs[i] = (rand() % colors) + 1;
+        }
+        packCode(pegs, length, &multi.secrets[s]);
+    }
+
+    if (withHints && codeSpaceInit(&multi.space, length, colors)) {
+        multi.alive = malloc(sizeof(uint16_t) * multi.space.n);
+        multi.fbs = malloc(multi.space.n);
+        for (uint32_t i = 0; i < multi.space.n; i++) {
+            multi.alive[i] = (uint16_t)((1u << k) - 1);
+        }
+        for (int s = 0; s < k; s++) {
+            multi.left[s] = multi.space.n;
+        }
+        multi.tracking = TRUE;
+    }
+    multi.active = TRUE;
+    return TRUE;
+}
+
+int multiAllSolved(void) {
+    return multi.solved == (1u << multi.k) - 1;
+}
+
+void multiPrintSecrets(void) {
+    for (int s = 0; s < multi.k; s++) {
+        fprintf(stderr, "  %d:", s+1);
+        for (int i = 0; i < multi.length; i++)
+            fprintf(stderr, " %d", multi.secrets[s].peg[i]);
+        fprintf(stderr, "\n");
+    }
+}
+
+//Screen 0 sums up the round (secrets solved, best exact/color among the rest); screen s+1 is secret s
+static void multiLcdShow(int screen) {
+    char message1[17], message2[17];
+    int bestExact = -1, bestColor = 0;
+
+    if (screen == 0) {
+        for (int s = 0; s < multi.k; s++) {
+            int exact = FB_EXACT(multi.fb[s]), color = FB_COLOR(multi.fb[s]);
+            if (!((multi.solved >> s) & 1) && (exact > bestExact || (exact == bestExact && color > bestColor))) {
+                bestExact = exact;
+                bestColor = color;
+            }
+        }
+        snprintf(message1, sizeof(message1), "Solved %d/%d", __builtin_popcount(multi.solved), multi.k);
+        if (bestExact < 0)
+            snprintf(message2, sizeof(message2), "All solved");
+        else
+            snprintf(message2, sizeof(message2), "Best E:%d C:%d", bestExact, bestColor);
+    }
+    else {
+        int s = screen - 1;
+        snprintf(message1, sizeof(message1), "Secret %d/%d", s+1, multi.k);
+        if ((multi.solved >> s) & 1)
+            snprintf(message2, sizeof(message2), "Solved");
+        else
+            snprintf(message2, sizeof(message2), "E:%d C:%d", FB_EXACT(multi.fb[s]), FB_COLOR(multi.fb[s]));
+    }
+    lcdClear(multi.lcd);
+    lcdPosition(multi.lcd, 0, 0);
+    lcdPuts(multi.lcd, message1);
+    lcdPosition(multi.lcd, 0, 1);
+    lcdPuts(multi.lcd, message2);
+    multi.screen = screen;
+    multi.shownAt = monotonicMicros() / 1000;
+}
+
+//Scores a guess against every secret in one batch, updates the candidate sets and puts the round's
+//summary on the LCD; the per-secret screens follow from multiLcdStep() without blocking the game
+void multiRespond(const int *guess, int roundNum, struct lcdDataStruct *lcd) {
+    struct packedCode g;
+
+    packCode(guess, multi.length, &g);
+    if (multi.rounds < MULTI_MAX_SECRETS + MULTI_EXTRA_ROUNDS)
+        multi.played[multi.rounds++] = g;
+    scoreMany(&g, multi.secrets, multi.k, multi.length, multi.fb);
+    for (int s = 0; s < multi.k; s++) {
+        if (FB_EXACT(multi.fb[s]) == multi.length)
+            multi.solved |= 1u << s;
+    }
+
+    if (multi.tracking) {					//one pass over the codes updates all K sets
+        scoreMany(&g, multi.space.codes, multi.space.n, multi.length, multi.fbs);
+        memset(multi.left, 0, sizeof(multi.left));
+        for (uint32_t i = 0; i < multi.space.n; i++) {
+            uint16_t mask = multi.alive[i];
+            for (uint16_t m = mask; m != 0; m &= m - 1) {
+                int s = __builtin_ctz(m);
+                if (multi.fbs[i] != multi.fb[s])
+                    mask &= ~(1u << s);
+                else
+                    multi.left[s]++;
+            }
+            multi.alive[i] = mask;
+        }
+    }
+
+    for (int s = 0; s < multi.k; s++) {
+        int exact = FB_EXACT(multi.fb[s]), color = FB_COLOR(multi.fb[s]);
+        printf("Secret %d: exact %d, color %d%s\n", s+1, exact, color,
+               (multi.solved >> s) & 1 ? (exact == multi.length ? "  SOLVED" : "  (solved)") : "");
+        feedEvent(roundNum, guess, multi.length, exact, color);
+    }
+    multi.lcd = lcd;
+    multiLcdShow(0);
+}
+
+//Advances the LCD to the next screen once the current one has been up for MULTI_LCD_MS; cheap
+//enough to call from every button poll, so the cycle never holds up the next guess
+void multiLcdStep(void) {
+    if (!multi.active || multi.lcd == NULL || monotonicMicros() / 1000 - multi.shownAt < MULTI_LCD_MS)
+        return;
+    multiLcdShow((multi.screen + 1) % (multi.k + 1));
+}
+
+//Hint: the advisor's pick for the unsolved secret with the fewest candidates left
+int multiHint(int *pegs) {
+    int best = -1;
+    if (!multi.tracking)
+        return FALSE;
+    for (int s = 0; s < multi.k; s++) {
+        if (!((multi.solved >> s) & 1) && (best < 0 || multi.left[s] < multi.left[best]))
+            best = s;
+    }
+    if (best < 0 || multi.left[best] == 0)
+        return FALSE;
+
+    struct packedCode *cands = malloc(sizeof(struct packedCode) * multi.left[best]), guess;
+    uint32_t nc = 0;
+    for (uint32_t i = 0; i < multi.space.n; i++) {
+        if ((multi.alive[i] >> best) & 1)
+            cands[nc++] = multi.space.codes[i];
+    }
+    chooseGuess(&multi.space, multi.played, multi.rounds, cands, nc, &guess);
+    free(cands);
+
+    printf("  Candidates left:");
+    for (int s = 0; s < multi.k; s++)
+        printf(" %u", (multi.solved >> s) & 1 ? 0 : multi.left[s]);
+    printf("\n");
+    for (int i = 0; i < multi.length; i++) {
+        pegs[i] = guess.peg[i];
+    }
+    return TRUE;
+}
+
+/* ***************************************************************************** */
+/* Game server: many sessions over a UNIX socket, driven by one epoll loop       */
+/* One connection plays one session at a time, using a line protocol:            */
+/*   NEW <length> <colors>   ->  OK                                              */
+/*   GUESS <p1> ... <pL>     ->  FB <exact> <color> | WIN <rounds> | LOSE <secret> */
+/*   QUIT                    ->  (connection closed)                             */
+/* Anything else gets "ERR <reason>". Scoring is the same gameScorer as game().  */
+
+struct serverSession
+{
+    int fd, dead ;
+    int playing, length, colors, rounds ;
+    int secret [MAX_PEGS] ;
+    gameScoreFn scorer ;
+    int inLen ;
+    char in [SERVER_LINE] ;
+    struct serverSession *next ;			// free list link while the slot is unused
+} ;
+
+// fixed pool of session slots, so accepting a client never touches malloc
+struct sessionPool
+{
+    struct serverSession *slots, *free ;
+    uint32_t used ;
+} ;
+
+static struct sessionPool sessions ;
+
+void sessionPoolInit(struct sessionPool *pool, uint32_t size) {
+    pool->slots = calloc(size, sizeof(struct serverSession));
+    if (pool->slots == NULL)
+        failure(TRUE, "server: cannot allocate %u sessions\n", size);
+    pool->free = NULL;
+    for (uint32_t i = size; i-- > 0; ) {
+        pool->slots[i].next = pool->free;
+        pool->free = &pool->slots[i];
+    }
+    pool->used = 0;
+}
+
+struct serverSession *sessionAlloc(struct sessionPool *pool) {
+    struct serverSession *s = pool->free;
+    if (s == NULL)
+        return NULL;
+    pool->free = s->next;
+    pool->used++;
+    memset(s, 0, sizeof(*s));
+    return s;
+}
+
+void sessionFree(struct sessionPool *pool, struct serverSession *s) {
+    s->next = pool->free;
+    pool->free = s;
+    pool->used--;
+}
+
+//Lets a load test have thousands of sockets open
+static void raiseFileLimit(void) {
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+//Replies are a few bytes to a client waiting for them; one that lets its socket fill up is dropped
+static void serverReply(struct serverSession *s, const char *message, ...) {
+    va_list argp;
+    char buffer[SERVER_LINE];
+
+    va_start(argp, message);
+    int len = vsnprintf(buffer, sizeof(buffer), message, argp);
+    va_end(argp);
+    if (send(s->fd, buffer, len, MSG_NOSIGNAL) != len)	//a client gone mid-request gives EPIPE, not SIGPIPE
+        s->dead = TRUE;
+}
+
+static void serverLine(struct serverSession *s, char *line, uint64_t *finished) {
+    if (strncmp(line, "NEW", 3) == 0) {
+        int length, colors;
+        if (sscanf(line + 3, "%d %d", &length, &colors) != 2 || length < 1 || length > MAX_PEGS || colors < 1 || colors > MAX_COLORS) {
+            serverReply(s, "ERR bad configuration\n");
+            return;
+        }
+        s->playing = TRUE;
+        s->length = length;
+        s->colors = colors;
+        s->rounds = 0;
+        s->scorer = pickScorer(length, colors);
+        for (int i = 0; i < length; i++) {
+            s->secret[i] = (rand() % colors) + 1;
+        }
+        serverReply(s, "OK\n");
+    }
+    else if (strncmp(line, "GUESS", 5) == 0) {
+        int guess[MAX_PEGS], exact, color;
+        char *p = line + 5, *end;
+        if (!s->playing) {
+            serverReply(s, "ERR no game, send NEW first\n");
+            return;
+        }
+        for (int i = 0; i < s->length; i++, p = end) {
+            long v = strtol(p, &end, 10);
+            if (end == p || v < 1 || v > s->colors) {
+                serverReply(s, "ERR guess needs %d colors in 1..%d\n", s->length, s->colors);
+                return;
+            }
+            guess[i] = (int)v;
+        }
+
+        s->scorer(guess, s->secret, s->length, s->colors, &exact, &color);
+        s->rounds++;
+        if (exact == s->length) {
+            s->playing = FALSE;
+            (*finished)++;
+            serverReply(s, "WIN %d\n", s->rounds);
+        }
+        else if (s->rounds == MAX_ROUNDS) {
+            char secret[3 * MAX_PEGS + 1];
+            int len = 0;
+            for (int i = 0; i < s->length && len < (int)sizeof(secret); i++) {
+                len += snprintf(secret + len, sizeof(secret) - len, " %d", s->secret[i]);
+            }
+            s->playing = FALSE;
+            (*finished)++;
+            serverReply(s, "LOSE%s\n", secret);
+        }
+        else {
+            serverReply(s, "FB %d %d\n", exact, color);
+        }
+    }
+    else if (strncmp(line, "QUIT", 4) == 0) {
+        s->dead = TRUE;
+    }
+    else {
+        serverReply(s, "ERR unknown command\n");
+    }
+}
+
+//Handles whatever the client sent; complete lines are answered, a partial one is kept
+static void serverRead(struct serverSession *s, uint64_t *requests, uint64_t *finished) {
+    for (;;) {
+        ssize_t got = read(s->fd, s->in + s->inLen, sizeof(s->in) - 1 - s->inLen);
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (got <= 0) {
+            s->dead = TRUE;
+            return;
+        }
+        s->inLen += got;
+        s->in[s->inLen] = '\0';
+
+        char *line = s->in, *nl;
+        while (!s->dead && (nl = strchr(line, '\n')) != NULL) {
+            *nl = '\0';
+            serverLine(s, line, finished);
+            (*requests)++;
+            line = nl + 1;
+        }
+        s->inLen -= line - s->in;
+        memmove(s->in, line, s->inLen);
+        if (s->dead || s->inLen == sizeof(s->in) - 1) {	//overlong line: drop the client
+            s->dead = TRUE;
+            return;
+        }
+    }
+}
+
+//'S' mode: serves games until killed, printing throughput every second it is busy
+int serverRun(void) {
+    struct sockaddr_un addr;
+    struct epoll_event ev, events[SERVER_EVENTS];
+    uint64_t requests = 0, finished = 0, lastRequests = 0, lastFinished = 0;
+    uint64_t lastReport = monotonicMicros();
+
+    raiseFileLimit();
+    srand(time(NULL));
+    sessionPoolInit(&sessions, SERVER_MAX_SESSIONS);
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SERVER_SOCKET, sizeof(addr.sun_path) - 1);
+    unlink(SERVER_SOCKET);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, SOMAXCONN) < 0)
+        return failure(TRUE, "server: cannot listen on %s: %s\n", SERVER_SOCKET, strerror(errno));
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;					//NULL marks the listening socket
+    epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &ev);
+    printf("Serving games on %s\n", SERVER_SOCKET);
+
+    for (;;) {
+        int n = epoll_wait(ep, events, SERVER_EVENTS, 1000);
+        for (int i = 0; i < n; i++) {
+            struct serverSession *s = events[i].data.ptr;
+            if (s == NULL) {
+                int fd;
+                while ((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    s = sessionAlloc(&sessions);
+                    if (s == NULL) {
+                        close(fd);				//pool exhausted
+                        continue;
+                    }
+                    s->fd = fd;
+                    ev.events = EPOLLIN;
+                    ev.data.ptr = s;
+                    epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+                }
+                continue;
+            }
+            serverRead(s, &requests, &finished);
+            if (s->dead) {
+                epoll_ctl(ep, EPOLL_CTL_DEL, s->fd, NULL);
+                close(s->fd);
+                sessionFree(&sessions, s);
+            }
+        }
+
+        uint64_t now = monotonicMicros();
+        if (now - lastReport >= 1000000) {
+            if (requests != lastRequests)
+                printf("%u clients, %.0f games/s, %.0f requests/s\n", sessions.used,
+                       (finished - lastFinished) * 1e6 / (now - lastReport), (requests - lastRequests) * 1e6 / (now - lastReport));
+            lastRequests = requests;
+            lastFinished = finished;
+            lastReport = now;
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
+
+/* ----------------------*/
+/* load test: LOAD_CLIENTS simulated players hammering a running server */
+
+struct loadClient
+{
+    int fd ;
+    uint64_t sentAt ;
+    int inLen ;
+    char in [SERVER_LINE] ;
+} ;
+
+static void loadSend(struct loadClient *c, const char *line, int len) {
+    c->sentAt = monotonicMicros();
+    if (send(c->fd, line, len, MSG_NOSIGNAL) != len)
+        failure(TRUE, "load: write failed: %s\n", strerror(errno));
+}
+
+//Plays random guesses, starting a new game as soon as one ends
+static void loadNext(struct loadClient *c, const char *reply, uint64_t *games) {
+    char line[SERVER_LINE];
+    int len;
+
+    if (strncmp(reply, "WIN", 3) == 0 || strncmp(reply, "LOSE", 4) == 0)
+        (*games)++;
+    if (strncmp(reply, "OK", 2) == 0 || strncmp(reply, "FB", 2) == 0) {
+        len = sprintf(line, "GUESS");
+        for (int i = 0; i < LOAD_LENGTH; i++) {
+            len += sprintf(line + len, " %d", rand() % LOAD_COLORS + 1);
+        }
+        len += sprintf(line + len, "\n");
+    }
+    else {
+        len = sprintf(line, "NEW %d %d\n", LOAD_LENGTH, LOAD_COLORS);
+    }
+    loadSend(c, line, len);
+}
+
+//'L' mode: reports games per second and the per-request latency distribution
+int loadTest(void) {
+    static struct loadClient clients[LOAD_CLIENTS];
+    struct sockaddr_un addr;
+    struct epoll_event ev, events[SERVER_EVENTS];
+    struct jitterProbe latency = { "latency" };
+    uint64_t games = 0;
+
+    raiseFileLimit();
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SERVER_SOCKET, sizeof(addr.sun_path) - 1);
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    for (int i = 0; i < LOAD_CLIENTS; i++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+            return failure(TRUE, "load: cannot connect client %d to %s: %s\n", i, SERVER_SOCKET, strerror(errno));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        clients[i].fd = fd;
+        ev.events = EPOLLIN;
+        ev.data.ptr = &clients[i];
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+    }
+    printf("%d clients connected, playing %dx%d for %d s\n", LOAD_CLIENTS, LOAD_LENGTH, LOAD_COLORS, LOAD_SECONDS);
+
+    uint64_t start = monotonicMicros();
+    for (int i = 0; i < LOAD_CLIENTS; i++) {
+        loadNext(&clients[i], "", &games);
+    }
+    while (monotonicMicros() - start < (uint64_t)LOAD_SECONDS * 1000000) {
+        int n = epoll_wait(ep, events, SERVER_EVENTS, 100);
+        for (int i = 0; i < n; i++) {
+            struct loadClient *c = events[i].data.ptr;
+            ssize_t got = read(c->fd, c->in + c->inLen, sizeof(c->in) - 1 - c->inLen);
+            if (got <= 0) {
+                if (got < 0 && errno == EAGAIN)
+                    continue;
+                return failure(TRUE, "load: server closed the connection\n");
+            }
+            c->inLen += got;
+            c->in[c->inLen] = '\0';
+            char *nl = strchr(c->in, '\n');
+            if (nl == NULL)
+                continue;
+            jitterRecord(&latency, monotonicMicros() - c->sentAt);
+            if (strncmp(c->in, "ERR", 3) == 0)
+                return failure(TRUE, "load: server said %s", c->in);
+            *nl = '\0';
+            loadNext(c, c->in, &games);
+            c->inLen = 0;					//one request in flight per client
+        }
+    }
+
+    double seconds = (monotonicMicros() - start) / 1e6;
+    printf("%llu games in %.1f s: %.0f games/s, %.0f requests/s\n", (unsigned long long)games, seconds,
+           games / seconds, latency.samples / seconds);
+    if (latency.samples == 0)
+        return failure(TRUE, "load: no reply from the server within %d s\n", LOAD_SECONDS);
+    printf("latency: mean %llu us, p50 <= %llu us, p99 <= %llu us, max %llu us\n",
+           (unsigned long long)(latency.sumUs / latency.samples),
+           (unsigned long long)jitterPercentile(&latency, 0.50),
+           (unsigned long long)jitterPercentile(&latency, 0.99),
+           (unsigned long long)latency.maxUs);
+    for (int i = 0; i < LOAD_CLIENTS; i++) {
+        close(clients[i].fd);
+    }
+    return 0;
+}
+
+/* ***************************************************************************** */
+/* Game history: every finished game as a fixed-size record in an mmap'ed log.   */
+/* The header keeps running totals per configuration, so the start screen can    */
+/* show win rate and average attempts without reading the records. When the log  */
+/* is full the older half is rotated out to HISTORY_FILE.1 and the rest moved     */
+/* down, keeping the file (and the SD card writes) bounded.                       */
+
+#define HISTORY_MAGIC	0x4D4D4849			// "MMHI"
+#define HISTORY_VERSION	2
+
+struct historyRecord
+{
+    int64_t startedAt ;					// time()
+    uint32_t seed ;					// srand() seed of the secret, 0 if entered by a player
+    int16_t length, colors ;
+    int8_t mode, won, rounds, pad ;
+    uint8_t guesses [HISTORY_ROUNDS][MAX_PEGS] ;
+    uint8_t feedback [HISTORY_ROUNDS] ;			// FEEDBACK(exact, color); solved count in multi mode
+    uint32_t roundMs [HISTORY_ROUNDS] ;			// from the start of the round to its feedback
+} ;
+
+struct historyStats
+{
+    int32_t mode ;					// modes allow different rounds, so each gets its own totals
+    int32_t length, colors ;
+    uint32_t games, wins ;
+    uint64_t winAttempts ;				// sum of the rounds taken by won games
+} ;
+
+struct historyHeader
+{
+    uint32_t magic, version ;
+    uint32_t capacity, count ;				// records in the file / in use
+    uint32_t configs ;
+    struct historyStats stats [HISTORY_CONFIGS] ;
+} ;
+
+static struct historyHeader *history ;
+static struct historyRecord historyCurrent ;
+
+static struct historyRecord *historyRecords(void) {
+    return (struct historyRecord *)(history + 1);
+}
+
+//Maps the log, creating it on first use; the game runs fine without it
+void historyOpen(void) {
+    size_t size = sizeof(struct historyHeader) + sizeof(struct historyRecord) * HISTORY_CAPACITY;
+    struct stat st;
+    if (history != NULL)
+        return;
+    int fd = open(HISTORY_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        failure(FALSE, "history: cannot open %s: %s\n", HISTORY_FILE, strerror(errno));
+        return;
+    }
+    int fresh = (size_t)st.st_size != size;
+    if (fresh && ftruncate(fd, size) < 0) {
+        close(fd);
+        return;
+    }
+    void *p = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return;
+
+    history = (struct historyHeader *)p;
+    if (fresh || history->magic != HISTORY_MAGIC || history->version != HISTORY_VERSION) {
+        memset(history, 0, sizeof(struct historyHeader));
+        history->magic = HISTORY_MAGIC;
+        history->version = HISTORY_VERSION;
+        history->capacity = HISTORY_CAPACITY;
+    }
+}
+
+static struct historyStats *historyFind(int mode, int length, int colors, int create) {
+    for (uint32_t i = 0; i < history->configs; i++) {
+        if (history->stats[i].mode == mode && history->stats[i].length == length && history->stats[i].colors == colors)
+            return &history->stats[i];
+    }
+    if (!create || history->configs == HISTORY_CONFIGS)
+        return NULL;
+    struct historyStats *st = &history->stats[history->configs++];
+    st->mode = mode;
+    st->length = length;
+    st->colors = colors;
+    return st;
+}
+
+//Shows this mode and configuration's record on the terminal and the 16-column LCD
+void historyShowStats(struct lcdDataStruct *lcd, int mode, int length, int colors) {
+    char message1[17], message2[17];
+    struct historyStats *st = history != NULL ? historyFind(mode, length, colors, FALSE) : NULL;
+    if (st == NULL || st->games == 0)
+        return;
+
+    unsigned rate = (unsigned)((uint64_t)st->wins * 100 / st->games);
+    if (st->games < 10000)
+        snprintf(message1, sizeof(message1), "Won %u%% of %u", rate, st->games);
+    else
+        snprintf(message1, sizeof(message1), "Won %u%% of %uk", rate, st->games / 1000);
+    if (st->wins != 0)
+        snprintf(message2, sizeof(message2), "Avg %.1f tries", (double)st->winAttempts / st->wins);
+    else
+        snprintf(message2, sizeof(message2), "No wins yet");
+    printf("Mode %d, %dx%d so far: %s, %s\n\n", mode, length, colors, message1, message2);
+
+    lcdClear(lcd);
+    lcdPosition(lcd, 0, 0);
+    lcdPuts(lcd, message1);
+    lcdPosition(lcd, 0, 1);
+    lcdPuts(lcd, message2);
+}
+
+void historyBegin(int length, int colors, int mode, unsigned seed) {
+    memset(&historyCurrent, 0, sizeof(historyCurrent));
+    historyCurrent.startedAt = time(NULL);
+    historyCurrent.seed = seed;
+    historyCurrent.length = length;
+    historyCurrent.colors = colors;
+    historyCurrent.mode = mode;
+}
+
+void historyRound(const int *guess, int length, int exact, int color, uint32_t ms) {
+    int r = historyCurrent.rounds;
+    if (r == HISTORY_ROUNDS)
+        return;
+    for (int i = 0; i < length && i < MAX_PEGS; i++) {
+        historyCurrent.guesses[r][i] = (uint8_t)guess[i];
+    }
+    historyCurrent.feedback[r] = FEEDBACK(exact, color);
+    historyCurrent.roundMs[r] = ms;
+    historyCurrent.rounds = r + 1;
+}
+
+//Moves the newer half of a full log to the front, after saving the older half to HISTORY_FILE.1
+static void historyRotate(void) {
+    uint32_t keep = history->count / 2, drop = history->count - keep;
+    int fd = open(HISTORY_FILE ".1", O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        if (write(fd, historyRecords(), sizeof(struct historyRecord) * drop) < 0)
+            failure(FALSE, "history: cannot archive old games: %s\n", strerror(errno));
+        close(fd);
+    }
+    memmove(historyRecords(), historyRecords() + drop, sizeof(struct historyRecord) * keep);
+    history->count = keep;
+}
+
+//Appends the game just played and folds it into the totals
+void historyFinish(int won, int attempts) {
+    if (history == NULL)
+        return;
+    if (history->count == history->capacity)
+        historyRotate();
+
+    historyCurrent.won = won;
+    historyRecords()[history->count++] = historyCurrent;
+
+    struct historyStats *st = historyFind(historyCurrent.mode, historyCurrent.length, historyCurrent.colors, TRUE);
+    if (st != NULL) {
+        st->games++;
+        if (won) {
+            st->wins++;
+            st->winAttempts += attempts;
+        }
+    }
+    msync(history, sizeof(struct historyHeader) + sizeof(struct historyRecord) * history->count, MS_ASYNC);
+}
+
+/* Main ----------------------------------------------------------------------------- */
+
+int main (int argc, char **argv)
+{
+    if(argc != 0 ) {
+        if(argv[argc-1][0] == 'd') {				// To enter debug mode, where the secret will be displayed to the user at the start
+            printf("Welcome to debug mode (YOU CHEATER)\n\n", argc);
+        }
+        else if(argv[argc-1][0] == 'r' || argv[argc-1][0] == 'j' || argv[argc-1][0] == 'h') {	// Option modes, see below
+            printf("Welcome to Mastermind (with options)\n\n");
+        }
+        else if(argv[argc-1][0] == 'b') {			// Benchmark of the batch scoring kernels
+            scoreBenchmark();
+            scorerBenchmark();
+            return symmetryCheck();
+        }
+        else if(argv[argc-1][0] == 'S') {			// Game server on a UNIX socket
+            return serverRun();
+        }
+        else if(argv[argc-1][0] == 'L') {			// Load test against a running server
+            return loadTest();
+        }
+        else if(argv[argc-1][0] == 'g') {			// Offline generation of the advisor's strategy cache
+            int length, colors;
+            printf("Enter the length of the secret: ");
+            scanf("%d",&length);
+            printf("Enter number of colours available: ");
+            scanf("%d",&colors);
+            return strategyGenerate(length, colors);
+        }
+        else if(argv[argc-1][0] == 's') {			// Spectator mode, follows a game running in another process
+            return spectate();
+        }
+        else if(argv[argc-1][0] == '.') {			// Normal game mode
+            printf("Welcome to Mastermind :)\n\n");
+        }
+        else {
+            printf("This is not a supported mode(try 'd' or nothing)\n\n");
+        }
+
+    }
+
+    // 'r' anywhere in the mode (e.g. "dr") turns on real-time scheduling, 'j' the jitter report
+    if (argc > 1 && strchr(argv[argc-1], 'r') != NULL)
+        realtimeSetup();
+    if (argc > 1 && strchr(argv[argc-1], 'j') != NULL)
+        jitterStart();
+    hintMode = argc > 1 && strchr(argv[argc-1], 'h') != NULL;	// 'h': show the advisor's hints
+
+    int   fd ;
+
+    //printf ("Raspberry Pi button controlled LED (button in %d, led out %d)\n", BUTTON, LEDYELLOW) ;
+
+    if (geteuid () != 0)
+        fprintf (stderr, "setup: Must be root. (Did you forget sudo?)\n") ;
+
+    // -----------------------------------------------------------------------------
+    // constants for RPi2
+    gpiobase = 0x3F200000 ;
+
+    // -----------------------------------------------------------------------------
+    // memory mapping
+    // Open the master /dev/memory device
+
+    if ((fd = open ("/dev/mem", O_RDWR | O_SYNC | O_CLOEXEC) ) < 0)		//enables file read and write
+        return failure (FALSE, "setup: Unable to open /dev/mem: %s\n", strerror (errno)) ;
+
+    // GPIO:
+    gpio = (uint32_t *)mmap(0, BLOCK_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, gpiobase) ;
+    if ((int32_t)gpio == -1)
+        return failure (FALSE, "setup: mmap (GPIO) failed: %s\n", strerror (errno)) ;
+
+    // -----------------------------------------------------------------------------
+    // setting the mode
+
+    // controlling YELLOW LED pin 13
+    pinMode(LEDYELLOW, OUTPUT);			//calls the inline function for setting the pin and mode, in this case it's output
+
+    // controller RED LED pin 5
+    pinMode(LEDRED, OUTPUT);			//calls the inline function for setting the pin and mode, in this case it's output
+
+    // controlling button pin 
+    pinMode(BUTTON, INPUT);			//calls the inline function for setting the pin and mode, here it's input because we're using a button
+
+    // -----------------------------------------------------------------------------
+    struct lcdDataStruct *lcd = setlcd();
+
+    int mode;
+    int length;
+    int colors;
+    printf("1-Single Player(Randomly Generated)\n2-Two Player\n3-Evil Secret Keeper\n4-Multi Secret\nplease select an option: ");		//providing the user with an option, which will be entered through the terminal
+    scanf("%d",&mode);
+
+    printf("Enter the length of the secret: ");
+    scanf("%d",&length);
+
+    printf("Enter number of colours available: ");
+    scanf("%d",&colors);
+    printf("\n\n");
+
+    gameScorer = pickScorer(length, colors);		//unrolled scorer when this configuration has one
+    feedOpen(length, colors);				//lets other processes watch the game through shared memory
+    if (hintMode && mode != 4)
+        advisorStart(length, colors);			//maps the cached strategy for this configuration
+    historyOpen();
+    historyShowStats(lcd, mode, length, colors);		//win rate and average attempts from earlier games of this mode
+    unsigned seed = time(NULL);
+
+    if (mode==1) {
+
+        int secret[length];
+        srand(seed);					//randomly generates the secret for the user, that will be used in the game
+        for (int i=0; i<length; i++) {
+            secret[i]=(rand() % colors)+1 ;		//stores each random value in an array, the random value starts from 1 and goes up tp the number of colours available 
+        }
+        if(argv[argc-1][0] == 'd') {			//debug mode
+            printf("The secret is\n");
+            for(int i=0; i<length; i++) {
+                fprintf(stderr,"%d   ", secret[i]);		//displays secret for the user
+            }
+        }
+        delay(3000);
+        historyBegin(length, colors, mode, seed);
+        fprintf(stderr, "\n\n-----------------\nStarting Round 1\n-----------------\n\n");
+        game(secret, length, colors, lcd, 0);			//takes in the arguments for the game function
+    }
+    else if (mode==2) {
+        delay(3000);
+        int *secret = colorInput(length, colors);		//used a pointer to point to the values passed into the colorInput function
+
+        if(argv[argc-1][0] == 'd') {
+            printf("The secret is\n");
+            for(int i=0; i<length; i++) {
+                fprintf(stderr,"%d   ", secret[i]);
+            }
+        }
+        delay(3000);
+        historyBegin(length, colors, mode, 0);
+        fprintf(stderr, "\n\n-----------------\nStarting Round 1\n-----------------\n\n");
+        game(secret, length, colors, lcd, 0);
+
+    }
+    else if (mode==3) {
+        srand(seed);
+        if (!evilStart(length, colors, argv[argc-1][0] == 'd')) {	//keeps every code that could still be the secret
+            printf("The evil secret keeper can't handle %dx%d\n\n------------------\n\n", length, colors);
+            main(argc, argv);
+            return 0;
+        }
+        delay(3000);
+        historyBegin(length, colors, mode, seed);
+        fprintf(stderr, "\n\n-----------------\nStarting Round 1\n-----------------\n\n");
+        game(NULL, length, colors, lcd, 0);			//there is no secret yet
+    }
+    else if (mode==4) {
+        int k;
+        printf("Enter number of secrets: ");
+        scanf("%d",&k);
+        srand(seed);
+        if (!multiStart(length, colors, k, hintMode)) {		//all secrets are scored together every round
+            printf("Multi secret needs 1-%d secrets of at most %d pegs and %d colours\n\n------------------\n\n", MULTI_MAX_SECRETS, MAX_PEGS, MAX_COLORS);
+            main(argc, argv);
+            return 0;
+        }
+        roundLimit = k + MULTI_EXTRA_ROUNDS;
+        if(argv[argc-1][0] == 'd') {
+            printf("The secrets are\n");
+            multiPrintSecrets();
+        }
+        delay(3000);
+        historyBegin(length, colors, mode, seed);
+        fprintf(stderr, "\n\n-----------------\nStarting Round 1\n-----------------\n\n");
+        game(NULL, length, colors, lcd, 0);
+    }
+    else{
+        printf("This game mode is not supported\n\n------------------\n\n");
+        main(argc, argv);
+    }
+
+}
+
+
+void game (int *mainSecret, int sequenceLength, int maxColors, struct lcdDataStruct *lcd, int roundNum) //roundNum variable created for the number of attempts
+{
+    if (roundNum!=roundLimit)		//checks if roundNum does not equal to the limit (3, more with several secrets), so the user can keep trying until roundNum=roundLimit
+    {
+        // now, listen to the button for each peg of the guess
+        int counter = 0;					//stores the number of times the button was pressed
+        int colors[sequenceLength];				//array to store the input from the user
+        int colorNum;
+        uint64_t roundStart = monotonicMicros();
+        feedState(roundNum, PHASE_INPUT, NULL, sequenceLength, 0, 0);
+        int hint[sequenceLength];
+        if (hintMode && (multi.active ? multiHint(hint) : advisorSuggest(hint))) {		//cached strategy lookup, or computed live if not cached yet
+            printf("  Hint:");
+            for (int i = 0; i < sequenceLength; i++)
+                printf(" %d", hint[i]);
+            printf("\n\n");
+        }
+        for(colorNum = 0; colorNum <sequenceLength; colorNum++) {
+            fprintf(stderr, "  -----------------\n\n  Starting guess %d\n\n", colorNum+1);
+            counter = readPeg(maxColors, colorNum > 0);	//long press accepts the peg, double-press undoes the last one
+            if (counter < 0) {
+                printf("\n  Undo guess %d\n\n", colorNum);
+                blinkRedAssembly(2);
+                colorNum -= 2;
+                continue;
+            }
+            printf("\n  End of guess %d\n", colorNum+1);
+            printf("  You pressed the button %d time(s)\n\n", counter);
+            colors[colorNum] = counter;			//adds the counter value to the array
+            pegEcho(counter);				//short red flash to accept the input, then one yellow flash per press to echo it
+        }
+        printf("  Guess entered in %.1f s\n", (monotonicMicros() - roundStart) / 1e6);
+        printf("  -----------------\n\n-----------------\nEnd of Round %d\n-----------------\n\n", roundNum+1);
+        blinkRedAssembly(4);				//Red LED blinks twice at the end of the users guess
+
+        int exact = 0;
+        int color = 0;
+        if (multi.active) {
+            multiRespond(colors, roundNum, lcd);		//all secrets scored in one pass; the LCD cycles through them during the next guess
+            exact = multiAllSolved() ? sequenceLength : 0;
+            feedState(roundNum, PHASE_SCORED, colors, sequenceLength, __builtin_popcount(multi.solved), 0);
+            historyRound(colors, sequenceLength, __builtin_popcount(multi.solved), 0, (monotonicMicros() - roundStart) / 1000);
+        }
+        else {
+            if (evil.active)
+                evilRespond(colors, sequenceLength, &exact, &color);		//answers so as to keep the most secrets possible
+            else
+                gameScorer(colors, mainSecret, sequenceLength, maxColors, &exact, &color);	//compares the guess with the secret
+            printf("Exact Matches: %d\n", exact);			//prints exact matches on the terminal
+            printf("Color Matches: %d\n", color);			//prints colour matches on the terminal
+            feedEvent(roundNum, colors, sequenceLength, exact, color);
+            advisorUpdate(colors, exact, color);
+            feedState(roundNum, PHASE_SCORED, colors, sequenceLength, exact, color);
+            historyRound(colors, sequenceLength, exact, color, (monotonicMicros() - roundStart) / 1000);
+
+            lcdClear(lcd) ;						//clears the LCD to allow data to be displayed
+
+            char message1[16];					//array to hold the integer as characters
+            char message2[16];
+            sprintf(message1, "Exact: %d", exact);			//returns the formatted string
+            sprintf(message2, "Color: %d", color);
+
+            lcdPosition (lcd, 0, 0) ;
+            lcdPuts (lcd, message1) ;		//Displays the string on the LCD, at the positions specified
+            lcdPosition (lcd, 0, 1) ;
+            lcdPuts (lcd, message2) ;
+
+            pwmShowFeedback(exact, color, sequenceLength, PWM_SHOW_MS);	//Yellow brightness shows exact matches, red brightness colour matches; keeps showing while the next guess is entered
+        }
+
+
+
+        roundNum++;				//roundNum values gets incremented
+        if(exact != sequenceLength) {		//checks if the exact matches equals the length of the secret, because if it does not then the guess was incorrect
+            printf("\n-----------------\nStarting Round %d\n-----------------\n\n", roundNum+1);
+            game(mainSecret, sequenceLength, maxColors, lcd, roundNum);		//starts the next round
+        }
+        else {					//if the exact matches is equal to the length then the guess is correct and game ends
+            pwmFinish();				//let the full-brightness feedback run out before the win blinks
+            blinkRedAssembly(1);			//turns the LED on
+            blinkYellowAssembly(6);			//blinks the Yellow LED 3 times
             blinkRedAssembly(2);			//Red LED blinks once to signal end of game
             printf("YOU WIN\n");
+            feedState(roundNum-1, PHASE_WON, colors, sequenceLength, exact, color);
+            historyFinish(TRUE, roundNum);
             lcdClear    (lcd) ;			//clears LCD for next game
 
             char attempts[16];
@@ -921,6 +3289,21 @@ void game (int *mainSecret, int sequenceLength, int maxColors, struct lcdDataStr
     }
     else {
         printf("You're out of attempts\nGame Over\n");
+        if (multi.active) {
+            printf("The secrets were\n");
+            multiPrintSecrets();
+        }
+        if (evil.active) {
+            int secret[sequenceLength];
+            evilSettle(secret, sequenceLength);
+            printf("The secret was");
+            for (int i = 0; i < sequenceLength; i++)
+                printf(" %d", secret[i]);
+            printf("\n");
+        }
+        feedState(roundNum-1, PHASE_LOST, NULL, sequenceLength, 0, 0);
+        historyFinish(FALSE, roundNum);
+        pwmFinish();				//the last round's feedback is still showing
     }
 
 